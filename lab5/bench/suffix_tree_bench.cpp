@@ -0,0 +1,254 @@
+#include "suffix_tree/suffix_tree.hpp"
+#include "suffix_tree/alphabet_suffix_tree.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <random>
+
+using namespace lab;
+
+// Synthetic corpora. None of them uses '$' or '#', which stay free for the
+// terminator and for building patterns that cannot occur.
+
+std::string uniformText(u64 size) {
+    std::mt19937_64 rng(42);
+    std::string text(size, ' ');
+    for (auto& c : text) {
+        c = static_cast<char>('%' + rng() % ('~' - '%' + 1));
+    }
+    return text;
+}
+
+std::string dnaText(u64 size) {
+    std::mt19937_64 rng(42);
+    std::string text(size, 'A');
+    for (auto& c : text) {
+        c = "ACGT"[rng() % 4];
+    }
+    return text;
+}
+
+std::string englishText(u64 size) {
+    static const char* words[] = {
+        "the", "of", "and", "to", "in", "is", "was", "that", "for", "it",
+        "with", "as", "his", "on", "be", "at", "by", "had", "this", "not",
+        "are", "but", "from", "or", "have", "an", "they", "which", "one", "you",
+        "were", "her", "all", "she", "there", "would", "their", "we", "him", "been",
+        "suffix", "tree", "edge", "node", "active", "length", "split", "link", "leaf", "root"
+    };
+    std::mt19937_64 rng(42);
+    std::string text;
+    text.reserve(size + 16);
+    while (text.size() < size) {
+        text += words[rng() % std::size(words)];
+        text += ' ';
+    }
+    text.resize(size);
+    return text;
+}
+
+// Copies of one 1 KB block with a rare point mutation: deep trees and long LCPs
+std::string repetitiveText(u64 size) {
+    std::mt19937_64 rng(42);
+    std::string block = dnaText(1024);
+    std::string text;
+    text.reserve(size + block.size());
+    while (text.size() < size) {
+        text += block;
+        block[rng() % block.size()] = "ACGT"[rng() % 4];
+    }
+    text.resize(size);
+    return text;
+}
+
+using Corpus = std::string (*)(u64);
+
+// Patterns of the given length sampled from the text, so that every one is a hit
+std::vector<std::string> samplePatterns(const std::string& text, u64 length, u64 seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<std::string> patterns;
+    length = std::min<u64>(length, text.size() - 1);
+    for (int i = 0; i < 1024; ++i) {
+        patterns.push_back(text.substr(rng() % (text.size() - length), length));
+    }
+    return patterns;
+}
+
+void reportMemory(benchmark::State& state, const SuffixTree& tree, const std::string& text) {
+    state.counters["bytes_per_char"] = static_cast<double>(tree.memoryUsage()) / static_cast<double>(text.size());
+}
+
+// Construction throughput and memory footprint of the built tree
+void BM_Build(benchmark::State& state, Corpus corpus) {
+    std::string text = corpus(static_cast<u64>(state.range(0))) + "$";
+    u64 bytes = 0;
+    for (auto _ : state) {
+        SuffixTree tree(text);
+        bytes = tree.memoryUsage();
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<i64>(text.size()));
+    state.counters["bytes_per_char"] = static_cast<double>(bytes) / static_cast<double>(text.size());
+}
+
+// Top-down traversal cost of patterns that occur in the text
+void BM_SearchHit(benchmark::State& state, Corpus corpus) {
+    std::string text = corpus(static_cast<u64>(state.range(0))) + "$";
+    SuffixTree tree(text);
+    std::vector<std::string> patterns = samplePatterns(text, 24, 7);
+
+    u64 i = 0;
+    for (auto _ : state) {
+        auto occurrences = tree.findOccurrences(patterns[i++ % patterns.size()]);
+        benchmark::DoNotOptimize(occurrences);
+    }
+    state.SetItemsProcessed(state.iterations());
+    reportMemory(state, tree, text);
+}
+
+// Same patterns with their last character replaced, so the walk fails at the very end
+void BM_SearchMiss(benchmark::State& state, Corpus corpus) {
+    std::string text = corpus(static_cast<u64>(state.range(0))) + "$";
+    SuffixTree tree(text);
+    std::vector<std::string> patterns = samplePatterns(text, 24, 7);
+    for (auto& pattern : patterns) {
+        pattern.back() = '#';
+    }
+
+    u64 i = 0;
+    for (auto _ : state) {
+        auto occurrences = tree.findOccurrences(patterns[i++ % patterns.size()]);
+        benchmark::DoNotOptimize(occurrences);
+    }
+    state.SetItemsProcessed(state.iterations());
+    reportMemory(state, tree, text);
+}
+
+// Same hits after freeze(), served by the flat BFS layout
+void BM_FrozenSearchHit(benchmark::State& state, Corpus corpus) {
+    std::string text = corpus(static_cast<u64>(state.range(0))) + "$";
+    SuffixTree tree(text);
+    tree.freeze();
+    std::vector<std::string> patterns = samplePatterns(text, 24, 7);
+
+    u64 i = 0;
+    for (auto _ : state) {
+        auto occurrences = tree.findOccurrences(patterns[i++ % patterns.size()]);
+        benchmark::DoNotOptimize(occurrences);
+    }
+    state.SetItemsProcessed(state.iterations());
+    reportMemory(state, tree, text);
+}
+
+// Reading every occurrence of short, frequent patterns; items are occurrences
+void BM_Enumerate(benchmark::State& state, Corpus corpus) {
+    std::string text = corpus(static_cast<u64>(state.range(0))) + "$";
+    SuffixTree tree(text);
+    std::vector<std::string> patterns = samplePatterns(text, 3, 8);
+
+    u64 i = 0;
+    i64 enumerated = 0;
+    for (auto _ : state) {
+        u64 sum = 0;
+        for (u32 suffix : tree.findOccurrences(patterns[i++ % patterns.size()])) {
+            sum += suffix;
+            ++enumerated;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(enumerated);
+    reportMemory(state, tree, text);
+}
+
+// Pairwise longest common substring of two independent halves of the size
+void BM_LCS(benchmark::State& state, Corpus corpus) {
+    u64 half = static_cast<u64>(state.range(0)) / 2;
+    std::string text = corpus(2 * half);
+    std::string s1 = text.substr(0, half);
+    std::string s2 = text.substr(half);
+    for (auto _ : state) {
+        auto lcs = SuffixTree::findLCS(s1, s2);
+        benchmark::DoNotOptimize(lcs);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<i64>(2 * half));
+}
+
+// Prefix-heavy query set: 32 anchors in the text, each queried with 32
+// extensions of a 16-character shared prefix, sorted
+std::vector<std::string> prefixHeavyPatterns(const std::string& text) {
+    std::mt19937_64 rng(9);
+    std::vector<std::string> patterns;
+    for (int i = 0; i < 32; ++i) {
+        u64 start = rng() % (text.size() - 64);
+        for (u64 length = 16; length < 48; ++length) {
+            patterns.push_back(text.substr(start, length));
+        }
+    }
+    std::sort(patterns.begin(), patterns.end());
+    return patterns;
+}
+
+// The prefix-heavy set one countPattern call at a time; items are patterns
+void BM_CountEach(benchmark::State& state, Corpus corpus) {
+    std::string text = corpus(static_cast<u64>(state.range(0))) + "$";
+    SuffixTree tree(text);
+    std::vector<std::string> patterns = prefixHeavyPatterns(text);
+    for (auto _ : state) {
+        u64 total = 0;
+        for (const auto& pattern : patterns) {
+            total += tree.countPattern(pattern);
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(patterns.size()));
+}
+
+// The same set through countPatterns, which walks shared prefixes once
+void BM_CountBatch(benchmark::State& state, Corpus corpus) {
+    std::string text = corpus(static_cast<u64>(state.range(0))) + "$";
+    SuffixTree tree(text);
+    std::vector<std::string> patterns = prefixHeavyPatterns(text);
+    for (auto _ : state) {
+        auto counts = tree.countPatterns(patterns);
+        benchmark::DoNotOptimize(counts);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(patterns.size()));
+}
+
+// Same hits on the DNA-specialised tree, to compare with BM_SearchHit/dna
+void BM_DnaSearchHit(benchmark::State& state) {
+    std::string text = dnaText(static_cast<u64>(state.range(0)));
+    DnaSuffixTree tree(text);
+    std::vector<std::string> patterns = samplePatterns(text, 24, 7);
+
+    u64 i = 0;
+    for (auto _ : state) {
+        auto occurrences = tree.findOccurrences(patterns[i++ % patterns.size()]);
+        benchmark::DoNotOptimize(occurrences);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["bytes_per_char"] = static_cast<double>(tree.memoryUsage()) / static_cast<double>(text.size());
+    state.counters["text_bytes"] = static_cast<double>(tree.textBytes());
+}
+
+// 1 KB to 100 MB in steps of 10; the largest sizes need several GB of memory
+void corpusSizes(benchmark::internal::Benchmark* benchmark) {
+    benchmark->RangeMultiplier(10)->Range(1000, 100000000)->Unit(benchmark::kMicrosecond);
+}
+
+#define LAB_CORPUS_BENCHMARKS(function)                                         \
+    BENCHMARK_CAPTURE(function, uniform, uniformText)->Apply(corpusSizes);      \
+    BENCHMARK_CAPTURE(function, dna, dnaText)->Apply(corpusSizes);              \
+    BENCHMARK_CAPTURE(function, english, englishText)->Apply(corpusSizes);      \
+    BENCHMARK_CAPTURE(function, repetitive, repetitiveText)->Apply(corpusSizes)
+
+LAB_CORPUS_BENCHMARKS(BM_Build);
+LAB_CORPUS_BENCHMARKS(BM_SearchHit);
+LAB_CORPUS_BENCHMARKS(BM_FrozenSearchHit);
+LAB_CORPUS_BENCHMARKS(BM_SearchMiss);
+LAB_CORPUS_BENCHMARKS(BM_Enumerate);
+LAB_CORPUS_BENCHMARKS(BM_LCS);
+LAB_CORPUS_BENCHMARKS(BM_CountEach);
+LAB_CORPUS_BENCHMARKS(BM_CountBatch);
+BENCHMARK(BM_DnaSearchHit)->Apply(corpusSizes);
+
+BENCHMARK_MAIN();
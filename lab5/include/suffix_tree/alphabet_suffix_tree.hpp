@@ -0,0 +1,153 @@
+#ifndef ALPHABET_SUFFIX_TREE_HPP
+#define ALPHABET_SUFFIX_TREE_HPP
+
+#include "../type_aliases.hpp"
+#include <array>
+#include <ostream>
+#include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lab {
+
+    // Alphabet policy for DNA. Symbols have constexpr ranks 1..4; rank 0 is the
+    // terminator, which sorts before every base and is never stored, so the
+    // bases fit in 2 bits.
+    struct DnaAlphabet {
+        static constexpr u32 Size = 5;            // Ranks, terminator included
+        static constexpr u32 BitsPerSymbol = 2;   // Bits per stored (non-terminator) symbol
+        static constexpr u8 Invalid = limit<u8>::max();
+
+        static constexpr u8 rank(char c) {
+            switch (c) {
+                case 'A': return 1;
+                case 'C': return 2;
+                case 'G': return 3;
+                case 'T': return 4;
+                default: return Invalid;
+            }
+        }
+
+        static constexpr char symbol(u8 rank) {
+            return "$ACGT"[rank];
+        }
+    };
+
+    // Text of an alphabet packed at Alphabet::BitsPerSymbol bits per symbol,
+    // followed by a virtual terminator of rank 0
+    template <class Alphabet>
+    class PackedText {
+    public:
+        // Constructors, throws std::invalid_argument on a symbol outside the alphabet
+        PackedText() = default;
+        explicit PackedText(std::string_view body);
+
+        // Rank of the symbol at pos, the terminator sits at size() - 1
+        u8 operator[](u64 pos) const;
+        u64 size() const;
+        std::string substr(u64 pos, u64 length) const;
+
+        // Bytes of packed storage
+        u64 ownedBytes() const;
+
+    private:
+        static constexpr u64 SymbolsPerWord = 64 / Alphabet::BitsPerSymbol;
+        static constexpr u64 SymbolMask = (u64(1) << Alphabet::BitsPerSymbol) - 1;
+        static_assert(Alphabet::Size - 1 <= SymbolMask + 1, "stored symbols must fit in BitsPerSymbol");
+
+        std::vector<u64> words;
+        u64 length = 0;  // Stored symbols, the terminator excluded
+    };
+
+    // Suffix tree specialised on an alphabet policy: the text is packed, every
+    // node has a fixed array of Alphabet::Size children indexed by symbol rank,
+    // and patterns are translated to ranks once. Answers the pattern queries
+    // of SuffixTree; patterns with symbols outside the alphabet never match.
+    // Instantiated for DnaAlphabet in alphabet_suffix_tree.cpp.
+    template <class Alphabet>
+    class AlphabetSuffixTree {
+    public:
+        using NodeIndex = u32;
+        // Suffix indexes of matching leaves in rank (DFS) order, a view into the tree
+        using Occurrences = std::span<const u32>;
+
+        // Constructors, the text is given without a terminator
+        explicit AlphabetSuffixTree(std::string_view text);
+
+        // Public interface
+        std::set<u64> searchPattern(const std::string& pattern) const;
+        u64 countPattern(const std::string& pattern) const;
+        Occurrences findOccurrences(const std::string& pattern) const;
+
+        // Tree properties
+        u64 getNodeCount() const;
+        // Bytes of the packed text alone
+        u64 textBytes() const;
+        // Bytes held by the text, nodes and leaf ranges
+        u64 memoryUsage() const;
+
+        template <class A>
+        friend std::ostream& operator<<(std::ostream& os, const AlphabetSuffixTree<A>& tree);
+
+    private:
+        static constexpr NodeIndex NoNode = limit<NodeIndex>::max();
+        static constexpr u32 OpenEnd = limit<u32>::max();
+        static constexpr u32 NoSuffix = limit<u32>::max();
+
+        struct Node {
+            u32 start;
+            u32 end;                  // Inclusive end of the edge label, OpenEnd for leaves
+            NodeIndex suffixLink;
+            u32 suffixIndex;          // NoSuffix for internal nodes
+            std::array<NodeIndex, Alphabet::Size> children;
+        };
+
+        // Explicit traversal stack entry for walks that also act after a subtree
+        struct VisitFrame {
+            NodeIndex node;
+            bool leaving;
+        };
+
+        NodeIndex newNode(u64 start, u32 end);
+        u64 edgeLength(const Node& node) const;
+        bool isLeaf(const Node& node) const;
+        void extendTree(u64 pos);
+        void indexLeaves();
+        NodeIndex findLocus(const std::string& pattern) const;
+
+        PackedText<Alphabet> text;
+        std::vector<Node> nodes;
+        std::vector<u32> leafOrder;   // Suffix indexes of all leaves in DFS order
+        std::vector<u32> leafRanks;   // Position of each node's first leaf in leafOrder
+        std::vector<u32> leafCounts;  // Leaves below each node
+        NodeIndex root;
+        NodeIndex activeNode;
+        u64 activeEdge;
+        u64 activeLength;
+        u64 remainingSuffixCount;
+        u64 leafEnd;
+    };
+
+    template <class Alphabet>
+    inline u8 PackedText<Alphabet>::operator[](u64 pos) const {
+        if (pos >= length) {
+            return 0;
+        }
+        u64 shift = pos % SymbolsPerWord * Alphabet::BitsPerSymbol;
+        return static_cast<u8>(1 + ((words[pos / SymbolsPerWord] >> shift) & SymbolMask));
+    }
+
+    template <class Alphabet>
+    inline u64 PackedText<Alphabet>::size() const {
+        return length + 1;
+    }
+
+    template <class Alphabet>
+    std::ostream& operator<<(std::ostream& os, const AlphabetSuffixTree<Alphabet>& tree);
+
+    using DnaSuffixTree = AlphabetSuffixTree<DnaAlphabet>;
+}
+
+#endif // ALPHABET_SUFFIX_TREE_HPP
@@ -0,0 +1,107 @@
+#ifndef CHILD_TABLE_HPP
+#define CHILD_TABLE_HPP
+
+#include "../type_aliases.hpp"
+
+namespace lab {
+
+    // Outgoing edges of an internal suffix tree node, keyed by the first
+    // character of the edge label. The layout adapts to the fan-out:
+    //  - Inline: up to InlineCapacity sorted entries stored in the table itself
+    //  - Sorted: up to SortedCapacity sorted entries in a small heap array
+    //  - Dense:  a 256-entry array indexed directly by the character
+    // Iteration always visits children in ascending char order.
+    class ChildTable {
+    public:
+        using NodeIndex = u32;
+
+        enum class Layout : u8 { Inline, Sorted, Dense };
+
+        static constexpr u16 InlineCapacity = 4;
+        static constexpr u16 SortedCapacity = 16;
+        static constexpr u16 DenseSize = 256;
+        static constexpr NodeIndex NoNode = limit<NodeIndex>::max();
+
+        // Constructors
+        ChildTable();
+
+        // Lookup and update
+        NodeIndex find(char key) const;
+        void set(char key, NodeIndex node);
+
+        // Table properties
+        u16 size() const;
+        bool empty() const;
+        Layout layout() const;
+        u64 heapBytes() const;
+
+        // Calls visit(key, node) for every child in ascending key order
+        template <class Visitor>
+        void forEach(Visitor&& visit) const;
+
+    private:
+        static u8 slot(char key);
+        void insertSorted(char* keys, NodeIndex* nodes, char key, NodeIndex node);
+        void promote();
+
+        Layout kind;
+        u16 count;
+        char inlineKeys[InlineCapacity];
+        NodeIndex inlineNodes[InlineCapacity];
+        std::unique_ptr<char[]> spillKeys;       // Sorted layout only
+        std::unique_ptr<NodeIndex[]> spillNodes; // Sorted and Dense layouts
+    };
+
+    inline u8 ChildTable::slot(char key) {
+        return static_cast<u8>(key);
+    }
+
+    inline ChildTable::NodeIndex ChildTable::find(char key) const {
+        switch (kind) {
+            case Layout::Inline:
+                for (u16 i = 0; i < count; ++i) {
+                    if (inlineKeys[i] == key) {
+                        return inlineNodes[i];
+                    }
+                }
+                return NoNode;
+            case Layout::Sorted:
+                for (u16 i = 0; i < count && spillKeys[i] <= key; ++i) {
+                    if (spillKeys[i] == key) {
+                        return spillNodes[i];
+                    }
+                }
+                return NoNode;
+            case Layout::Dense:
+                return spillNodes[slot(key)];
+        }
+        return NoNode;
+    }
+
+    template <class Visitor>
+    void ChildTable::forEach(Visitor&& visit) const {
+        switch (kind) {
+            case Layout::Inline:
+                for (u16 i = 0; i < count; ++i) {
+                    visit(inlineKeys[i], inlineNodes[i]);
+                }
+                break;
+            case Layout::Sorted:
+                for (u16 i = 0; i < count; ++i) {
+                    visit(spillKeys[i], spillNodes[i]);
+                }
+                break;
+            case Layout::Dense:
+                // Walk keys in char order, which differs from slot order when char is signed
+                for (int c = limit<char>::min(); c <= limit<char>::max(); ++c) {
+                    char key = static_cast<char>(c);
+                    if (spillNodes[slot(key)] != NoNode) {
+                        visit(key, spillNodes[slot(key)]);
+                    }
+                }
+                break;
+        }
+    }
+}
+
+#endif // CHILD_TABLE_HPP
@@ -0,0 +1,60 @@
+#ifndef DISK_SUFFIX_ARRAY_HPP
+#define DISK_SUFFIX_ARRAY_HPP
+
+#include "../type_aliases.hpp"
+#include <memory>
+#include <optional>
+#include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lab {
+
+    // Suffix array for texts larger than memory. build() sorts the suffixes of
+    // a text file by external prefix doubling: every round sorts fixed-size
+    // records in runs that fit the memory budget, merges the runs, and reads
+    // and writes its scratch files sequentially only. The result is one index
+    // file, the text followed by 64-bit suffix positions, which load() maps and
+    // queries by binary search without reading it into memory.
+    class DiskSuffixArray {
+    public:
+        using Occurrences = std::span<const u64>;
+
+        static constexpr u32 FormatVersion = 1;
+        // Smallest memory budget build() accepts
+        static constexpr u64 MinMemoryBudget = u64(1) << 20;
+
+        // Construction and persistence. Scratch files are created next to the
+        // index file and removed once it is written.
+        static void build(const std::string& textPath,
+                          const std::string& indexPath,
+                          u64 memoryBudget,
+                          std::optional<char> terminator = std::nullopt);
+        static DiskSuffixArray load(const std::string& path);
+
+        // Public interface
+        std::set<u64> searchPattern(const std::string& pattern) const;
+        u64 countPattern(const std::string& pattern) const;
+        Occurrences findOccurrences(const std::string& pattern) const;
+        static std::pair<u64, std::vector<u64>> findLCS(const std::string& s1, const std::string& s2);
+        static std::pair<u64, std::set<std::string>> findLCSString(const std::string& s1, const std::string& s2);
+
+        // Array properties
+        u64 getSuffix(u64 rank) const;
+        std::string_view getText() const;
+        u64 getSize() const;
+        // Bytes held in memory, 0: both arrays are in the mapped file
+        u64 memoryUsage() const;
+
+    private:
+        DiskSuffixArray() = default;
+
+        std::string_view text;
+        std::span<const u64> suffixes;
+        std::shared_ptr<const void> storage;  // The mapped file
+    };
+}
+
+#endif // DISK_SUFFIX_ARRAY_HPP
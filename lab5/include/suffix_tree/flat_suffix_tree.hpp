@@ -0,0 +1,78 @@
+#ifndef FLAT_SUFFIX_TREE_HPP
+#define FLAT_SUFFIX_TREE_HPP
+
+#include "../type_aliases.hpp"
+#include <string>
+#include <string_view>
+#include <memory>
+#include <span>
+#include <vector>
+#include <set>
+
+namespace lab {
+
+    class SuffixTree;
+
+    // Read-only, pointer-free layout of a built SuffixTree. Nodes are stored in
+    // BFS order so the children of a node are contiguous, every field is an
+    // offset or an index, and the whole structure can be saved to a versioned
+    // file and served straight from an mmap of it.
+    class FlatSuffixTree {
+    public:
+        using Occurrences = std::span<const u32>;
+
+        // On-disk and in-memory node record
+        struct Node {
+            u32 start;       // Edge label start in the text
+            u32 length;      // Edge label length, 0 for the root
+            u32 firstChild;  // Index of the first child, children are contiguous
+            u32 childCount;  // 0 for leaves
+            u32 leafBegin;   // First leaf of the subtree in the leaf order
+            u32 leafCount;   // Number of leaves of the subtree
+        };
+
+        static constexpr u32 FormatVersion = 1;
+
+        // Constructors
+        FlatSuffixTree(const std::string& text);
+        explicit FlatSuffixTree(const SuffixTree& tree);
+
+        // Persistence: load maps the file and checks every record in one pass,
+        // std::runtime_error for a truncated or corrupt file
+        void save(const std::string& path) const;
+        static FlatSuffixTree load(const std::string& path);
+
+        // Public interface
+        std::set<u64> searchPattern(const std::string& pattern) const;
+        u64 countPattern(std::string_view pattern) const;
+        Occurrences findOccurrences(std::string_view pattern) const;
+        static std::pair<u64, std::vector<u64>> findLCS(const std::string& s1, const std::string& s2);
+        static std::pair<u64, std::set<std::string>> findLCSString(const std::string& s1, const std::string& s2);
+
+        // Tree properties
+        std::string_view getText() const;
+        u64 getNodeCount() const;
+
+        // Bytes held in memory (0 for the arrays of a mapped file)
+        u64 memoryUsage() const;
+
+    private:
+        FlatSuffixTree() = default;
+
+        // Index of the highest node whose path label starts with the pattern, or NoNode
+        u32 findLocus(std::string_view pattern) const;
+        // Bounds of the node records and leaves against the other sections
+        bool recordsValid() const;
+
+        static constexpr u32 NoNode = limit<u32>::max();
+
+        std::string_view text;         // Text including the terminator
+        std::span<const Node> nodes;   // Nodes in BFS order, root first
+        std::span<const char> keys;    // First character of the edge into each node
+        std::span<const u32> leaves;   // Suffix indexes in DFS leaf order
+        std::shared_ptr<const void> storage;  // Owned arrays or the mapped file
+        u64 ownedBytes = 0;
+    };
+}
+
+#endif // FLAT_SUFFIX_TREE_HPP
@@ -0,0 +1,69 @@
+#ifndef FM_INDEX_HPP
+#define FM_INDEX_HPP
+
+#include "wavelet_matrix.hpp"
+#include "../type_aliases.hpp"
+#include <array>
+#include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lab {
+
+    // Compressed self-index: the BWT of the text in a wavelet matrix over the
+    // characters that occur, and the suffix array sampled every sampleRate text
+    // positions. The text itself is not kept. Counting is a backward search of
+    // two ranks per level and pattern character; locating walks LF from each
+    // match to the nearest sample, at most sampleRate - 1 steps. Takes
+    // ceil(log2 sigma) + 1 bits per character, plus 12.5% for rank, and 4 bytes
+    // per sample.
+    class FMIndex {
+    public:
+        using Index = u32;
+        // Positions of the matches in suffix order, in a per-thread buffer
+        // that stays valid until the next findOccurrences on the same thread
+        using Occurrences = std::span<const Index>;
+
+        static constexpr u32 DefaultSampleRate = 32;
+
+        // Constructors, any text: the BWT is taken with a virtual sentinel
+        explicit FMIndex(const std::string& text, u32 sampleRate = DefaultSampleRate);
+
+        // Public interface
+        std::set<u64> searchPattern(const std::string& pattern) const;
+        u64 countPattern(const std::string& pattern) const;
+        Occurrences findOccurrences(const std::string& pattern) const;
+        static std::pair<u64, std::vector<u64>> findLCS(const std::string& s1, const std::string& s2);
+        static std::pair<u64, std::set<std::string>> findLCSString(const std::string& s1, const std::string& s2);
+
+        // Index properties
+        u64 getSize() const;
+        u32 getSampleRate() const;
+        // Bytes held by the wavelet matrix, the samples and their marks
+        u64 memoryUsage() const;
+
+    private:
+        static constexpr u16 NoCode = limit<u16>::max();
+
+        // Half-open range of BWT rows whose suffixes start with the pattern
+        std::pair<u64, u64> findRange(std::string_view pattern) const;
+        // Occurrences of the code in bwt[0, row), not counting the sentinel
+        u64 rankCode(u8 code, u64 row) const;
+        // Row of the suffix one position earlier in the text
+        u64 lastToFirst(u64 row) const;
+        u64 locate(u64 row) const;
+
+        std::array<u16, 256> codes;   // Dense code of each character, NoCode if absent
+        std::vector<u64> firstRows;   // First row of each code, plus the row count
+        WaveletMatrix bwt;            // Codes of the BWT, the sentinel stored as code 0
+        RankBitVector sampled;        // Rows whose suffix position is sampled
+        std::vector<Index> samples;   // Suffix positions of the sampled rows, in row order
+        u64 sentinelRow;              // Row whose BWT character is the sentinel
+        u64 length;                   // Characters of the text
+        u32 sampleRate;
+    };
+}
+
+#endif // FM_INDEX_HPP
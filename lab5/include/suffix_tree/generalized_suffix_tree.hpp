@@ -0,0 +1,63 @@
+#ifndef GENERALIZED_SUFFIX_TREE_HPP
+#define GENERALIZED_SUFFIX_TREE_HPP
+
+#include "suffix_tree.hpp"
+#include "../type_aliases.hpp"
+#include <string>
+#include <vector>
+#include <set>
+
+namespace lab {
+
+    // Suffix tree over a collection of documents joined by a separator.
+    // findDocuments lists the distinct documents containing a pattern with
+    // Muthukrishnan's technique: every leaf links to the previous leaf of the
+    // same document, and a range minimum over those links finds each document
+    // once, so the cost follows the documents reported, not the occurrences.
+    class GeneralizedSuffixTree {
+    public:
+        static constexpr char Separator = '\x1f';
+        static constexpr char Terminator = '\0';
+
+        // Constructors, documents must not contain the separator or the terminator
+        explicit GeneralizedSuffixTree(const std::vector<std::string>& documents);
+
+        // Public interface
+        // Distinct documents containing the pattern, in leaf order, not sorted
+        std::vector<u32> findDocuments(const std::string& pattern) const;
+        // Longest substrings shared by at least k documents, k >= 1. Distinct
+        // documents below every node are counted in one pass in Hui's style:
+        // consecutive leaves of a document cancel one leaf at their LCA, found
+        // offline with a union-find, so no per-node document sets are kept.
+        std::pair<u64, std::set<std::string>> findLCSString(u64 k) const;
+        // Document holding the text position (a separator belongs to the document it ends)
+        u32 documentOf(u64 position) const;
+
+        // Tree properties
+        const SuffixTree& getTree() const;
+        u64 getDocumentCount() const;
+        u64 getDocumentStart(u32 document) const;
+
+        // Bytes held by the tree and the document listing arrays
+        u64 memoryUsage() const;
+
+    private:
+        // Length of the longest prefix of the suffix at position that stays in its document
+        u64 lengthInDocument(u64 position) const;
+        // Position of the smallest previousLeaf in [begin, end), begin < end
+        u64 minPreviousLeaf(u64 begin, u64 end) const;
+
+        static constexpr u64 BlockSize = 32;
+        static constexpr u32 NoDocument = limit<u32>::max();
+
+        SuffixTree tree;
+        std::vector<u64> documentStarts;  // Text position where each document starts
+        std::vector<u32> leafDocuments;   // Document of each leaf in leaf order
+        std::vector<u32> previousLeaf;    // 1 + rank of the previous leaf of the same document, 0 if none
+        // Sparse table over blocks of previousLeaf: blockMinima[k][b] is the
+        // position of the minimum in blocks b .. b + 2^k - 1
+        std::vector<std::vector<u32>> blockMinima;
+    };
+}
+
+#endif // GENERALIZED_SUFFIX_TREE_HPP
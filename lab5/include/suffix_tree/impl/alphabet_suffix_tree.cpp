@@ -0,0 +1,285 @@
+#include "../alphabet_suffix_tree.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace lab {
+
+    template <class Alphabet>
+    PackedText<Alphabet>::PackedText(std::string_view body)
+        :   words((body.size() + SymbolsPerWord - 1) / SymbolsPerWord, 0),
+            length(body.size()) {
+        for (u64 pos = 0; pos < body.size(); ++pos) {
+            u8 rank = Alphabet::rank(body[pos]);
+            if (rank == Alphabet::Invalid || rank == 0) {
+                throw std::invalid_argument("PackedText: symbol outside the alphabet at " + std::to_string(pos));
+            }
+            u64 shift = pos % SymbolsPerWord * Alphabet::BitsPerSymbol;
+            words[pos / SymbolsPerWord] |= u64(rank - 1) << shift;
+        }
+    }
+
+    template <class Alphabet>
+    std::string PackedText<Alphabet>::substr(u64 pos, u64 length) const {
+        std::string result;
+        for (u64 i = pos; i < std::min(size(), pos + length); ++i) {
+            result.push_back(Alphabet::symbol((*this)[i]));
+        }
+        return result;
+    }
+
+    template <class Alphabet>
+    u64 PackedText<Alphabet>::ownedBytes() const {
+        return words.size() * sizeof(u64);
+    }
+
+    template <class Alphabet>
+    AlphabetSuffixTree<Alphabet>::AlphabetSuffixTree(std::string_view body)
+        :   text(body) {
+        u64 size = text.size();
+        if (2 * size + 1 >= NoNode) {
+            throw std::length_error("AlphabetSuffixTree: text is too long for 32-bit node indices");
+        }
+        nodes.reserve(2 * size + 1);
+
+        root = newNode(0, 0);
+        activeNode = root;
+        activeEdge = 0;
+        activeLength = 0;
+        remainingSuffixCount = 0;
+        leafEnd = 0;
+
+        for (u64 i = 0; i < size; ++i) {
+            extendTree(i);
+        }
+        indexLeaves();
+    }
+
+    template <class Alphabet>
+    typename AlphabetSuffixTree<Alphabet>::NodeIndex AlphabetSuffixTree<Alphabet>::newNode(u64 start, u32 end) {
+        Node node;
+        node.start = static_cast<u32>(start);
+        node.end = end;
+        node.suffixLink = NoNode;
+        node.suffixIndex = NoSuffix;
+        node.children.fill(NoNode);
+        nodes.push_back(node);
+        return static_cast<NodeIndex>(nodes.size() - 1);
+    }
+
+    template <class Alphabet>
+    u64 AlphabetSuffixTree<Alphabet>::edgeLength(const Node& node) const {
+        u64 end = node.end == OpenEnd ? leafEnd : node.end;
+        return end - node.start + 1;
+    }
+
+    template <class Alphabet>
+    bool AlphabetSuffixTree<Alphabet>::isLeaf(const Node& node) const {
+        return node.end == OpenEnd;
+    }
+
+    // Ukkonen's extension of SuffixTree::extendTree with child lookups by rank
+    template <class Alphabet>
+    void AlphabetSuffixTree<Alphabet>::extendTree(u64 pos) {
+        leafEnd = pos;
+        remainingSuffixCount++;
+        NodeIndex lastNewNode = NoNode;
+
+        while (remainingSuffixCount > 0) {
+            if (activeLength == 0) {
+                activeEdge = pos;
+            }
+
+            u8 current = text[pos];
+            u8 active = text[activeEdge];
+            NodeIndex next = nodes[activeNode].children[active];
+            if (next == NoNode) {
+                // New leaf below the active node
+                NodeIndex leaf = newNode(pos, OpenEnd);
+                nodes[leaf].suffixIndex = static_cast<u32>(pos + 1 - remainingSuffixCount);
+                nodes[activeNode].children[active] = leaf;
+                if (lastNewNode != NoNode) {
+                    nodes[lastNewNode].suffixLink = activeNode;
+                    lastNewNode = NoNode;
+                }
+            } else {
+                // Skip/count down a whole edge
+                u64 length = edgeLength(nodes[next]);
+                if (activeLength >= length) {
+                    activeEdge += length;
+                    activeLength -= length;
+                    activeNode = next;
+                    continue;
+                }
+
+                // Rule 3, the suffix is already in the tree
+                if (text[nodes[next].start + activeLength] == current) {
+                    activeLength++;
+                    if (lastNewNode != NoNode) {
+                        nodes[lastNewNode].suffixLink = activeNode;
+                        lastNewNode = NoNode;
+                    }
+                    break;
+                }
+
+                // Split the edge
+                u64 nextStart = nodes[next].start;
+                NodeIndex split = newNode(nextStart, static_cast<u32>(nextStart + activeLength - 1));
+                nodes[activeNode].children[active] = split;
+
+                NodeIndex leaf = newNode(pos, OpenEnd);
+                nodes[leaf].suffixIndex = static_cast<u32>(pos + 1 - remainingSuffixCount);
+                nodes[split].children[current] = leaf;
+
+                nodes[next].start += static_cast<u32>(activeLength);
+                nodes[split].children[text[nodes[next].start]] = next;
+
+                if (lastNewNode != NoNode) {
+                    nodes[lastNewNode].suffixLink = split;
+                }
+                lastNewNode = split;
+            }
+
+            remainingSuffixCount--;
+            if (activeNode == root && activeLength > 0) {
+                activeLength--;
+                activeEdge = pos - remainingSuffixCount + 1;
+            } else if (activeNode != root) {
+                NodeIndex link = nodes[activeNode].suffixLink;
+                activeNode = link != NoNode ? link : root;
+            }
+        }
+    }
+
+    // Leaves in DFS order by rank, which is suffix order, and the range of each node
+    template <class Alphabet>
+    void AlphabetSuffixTree<Alphabet>::indexLeaves() {
+        leafOrder.clear();
+        leafOrder.reserve(text.size());
+        leafRanks.assign(nodes.size(), 0);
+        leafCounts.assign(nodes.size(), 0);
+
+        std::vector<VisitFrame> stack = {{root, false}};
+        while (!stack.empty()) {
+            VisitFrame frame = stack.back();
+            stack.pop_back();
+            NodeIndex node = frame.node;
+            if (frame.leaving) {
+                leafCounts[node] = static_cast<u32>(leafOrder.size()) - leafRanks[node];
+                continue;
+            }
+            leafRanks[node] = static_cast<u32>(leafOrder.size());
+            if (isLeaf(nodes[node])) {
+                leafOrder.push_back(nodes[node].suffixIndex);
+                leafCounts[node] = 1;
+                continue;
+            }
+            stack.push_back({node, true});
+            for (u32 rank = Alphabet::Size; rank-- > 0;) {
+                if (nodes[node].children[rank] != NoNode) {
+                    stack.push_back({nodes[node].children[rank], false});
+                }
+            }
+        }
+    }
+
+    template <class Alphabet>
+    typename AlphabetSuffixTree<Alphabet>::NodeIndex AlphabetSuffixTree<Alphabet>::findLocus(const std::string& pattern) const {
+        // Symbols outside the alphabet, the terminator included, never match;
+        // the text is stored by rank, so the walk below compares ranks only
+        for (char c : pattern) {
+            u8 rank = Alphabet::rank(c);
+            if (rank == Alphabet::Invalid || rank == 0) {
+                return NoNode;
+            }
+        }
+
+        NodeIndex current = root;
+        u64 matched = 0;
+        while (matched < pattern.size()) {
+            NodeIndex next = nodes[current].children[Alphabet::rank(pattern[matched])];
+            if (next == NoNode) {
+                return NoNode;
+            }
+            u64 start = nodes[next].start;
+            u64 length = std::min(edgeLength(nodes[next]), pattern.size() - matched);
+            for (u64 i = 0; i < length; ++i) {
+                if (text[start + i] != Alphabet::rank(pattern[matched + i])) {
+                    return NoNode;
+                }
+            }
+            matched += length;
+            current = next;
+        }
+        return current;
+    }
+
+    template <class Alphabet>
+    typename AlphabetSuffixTree<Alphabet>::Occurrences AlphabetSuffixTree<Alphabet>::findOccurrences(const std::string& pattern) const {
+        if (pattern.empty()) {
+            return {};
+        }
+        NodeIndex locus = findLocus(pattern);
+        if (locus == NoNode) {
+            return {};
+        }
+        return Occurrences(leafOrder).subspan(leafRanks[locus], leafCounts[locus]);
+    }
+
+    template <class Alphabet>
+    u64 AlphabetSuffixTree<Alphabet>::countPattern(const std::string& pattern) const {
+        return findOccurrences(pattern).size();
+    }
+
+    template <class Alphabet>
+    std::set<u64> AlphabetSuffixTree<Alphabet>::searchPattern(const std::string& pattern) const {
+        Occurrences occurrences = findOccurrences(pattern);
+        return std::set<u64>(occurrences.begin(), occurrences.end());
+    }
+
+    template <class Alphabet>
+    u64 AlphabetSuffixTree<Alphabet>::getNodeCount() const {
+        return nodes.size();
+    }
+
+    template <class Alphabet>
+    u64 AlphabetSuffixTree<Alphabet>::textBytes() const {
+        return text.ownedBytes();
+    }
+
+    template <class Alphabet>
+    u64 AlphabetSuffixTree<Alphabet>::memoryUsage() const {
+        return text.ownedBytes()
+            + nodes.size() * sizeof(Node)
+            + (leafOrder.size() + leafRanks.size() + leafCounts.size()) * sizeof(u32);
+    }
+
+    // Same layout as the SuffixTree printer, children in rank order
+    template <class Alphabet>
+    std::ostream& operator<<(std::ostream& os, const AlphabetSuffixTree<Alphabet>& tree) {
+        using NodeIndex = typename AlphabetSuffixTree<Alphabet>::NodeIndex;
+        std::vector<std::pair<NodeIndex, u64>> stack = {{tree.root, 0}};
+        while (!stack.empty()) {
+            auto [index, depth] = stack.back();
+            stack.pop_back();
+            const auto& node = tree.nodes[index];
+
+            if (index != tree.root) {
+                os << std::string(depth * 2, ' ')
+                   << tree.text.substr(node.start, tree.edgeLength(node))
+                   << (tree.isLeaf(node) ? " [" + std::to_string(node.suffixIndex) + "]" : "")
+                   << "\n";
+            }
+            for (u32 rank = Alphabet::Size; rank-- > 0;) {
+                if (node.children[rank] != AlphabetSuffixTree<Alphabet>::NoNode) {
+                    stack.push_back({node.children[rank], depth + 1});
+                }
+            }
+        }
+        return os;
+    }
+
+    template class PackedText<DnaAlphabet>;
+    template class AlphabetSuffixTree<DnaAlphabet>;
+    template std::ostream& operator<<(std::ostream& os, const AlphabetSuffixTree<DnaAlphabet>& tree);
+}
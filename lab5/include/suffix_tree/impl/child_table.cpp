@@ -0,0 +1,113 @@
+#include "../child_table.hpp"
+
+#include <algorithm>
+
+namespace lab {
+
+    ChildTable::ChildTable()
+        :   kind(Layout::Inline),
+            count(0),
+            inlineKeys{},
+            inlineNodes{} {}
+
+    void ChildTable::set(char key, NodeIndex node) {
+        // Replace an existing edge in place
+        switch (kind) {
+            case Layout::Inline:
+                for (u16 i = 0; i < count; ++i) {
+                    if (inlineKeys[i] == key) {
+                        inlineNodes[i] = node;
+                        return;
+                    }
+                }
+                break;
+            case Layout::Sorted:
+                for (u16 i = 0; i < count; ++i) {
+                    if (spillKeys[i] == key) {
+                        spillNodes[i] = node;
+                        return;
+                    }
+                }
+                break;
+            case Layout::Dense:
+                if (spillNodes[slot(key)] == NoNode) {
+                    ++count;
+                }
+                spillNodes[slot(key)] = node;
+                return;
+        }
+
+        // Otherwise insert a new edge, growing the layout when it is full
+        if ((kind == Layout::Inline && count == InlineCapacity) ||
+            (kind == Layout::Sorted && count == SortedCapacity)) {
+            promote();
+            if (kind == Layout::Dense) {
+                ++count;
+                spillNodes[slot(key)] = node;
+                return;
+            }
+        }
+
+        if (kind == Layout::Inline) {
+            insertSorted(inlineKeys, inlineNodes, key, node);
+        } else {
+            insertSorted(spillKeys.get(), spillNodes.get(), key, node);
+        }
+    }
+
+    void ChildTable::insertSorted(char* keys, NodeIndex* nodes, char key, NodeIndex node) {
+        u16 i = count;
+        while (i > 0 && keys[i - 1] > key) {
+            keys[i] = keys[i - 1];
+            nodes[i] = nodes[i - 1];
+            --i;
+        }
+        keys[i] = key;
+        nodes[i] = node;
+        ++count;
+    }
+
+    void ChildTable::promote() {
+        if (kind == Layout::Inline) {
+            spillKeys = std::make_unique<char[]>(SortedCapacity);
+            spillNodes = std::make_unique<NodeIndex[]>(SortedCapacity);
+            std::copy(inlineKeys, inlineKeys + count, spillKeys.get());
+            std::copy(inlineNodes, inlineNodes + count, spillNodes.get());
+            kind = Layout::Sorted;
+            return;
+        }
+
+        auto dense = std::make_unique<NodeIndex[]>(DenseSize);
+        std::fill(dense.get(), dense.get() + DenseSize, NoNode);
+        for (u16 i = 0; i < count; ++i) {
+            dense[slot(spillKeys[i])] = spillNodes[i];
+        }
+        spillKeys.reset();
+        spillNodes = std::move(dense);
+        kind = Layout::Dense;
+    }
+
+    u16 ChildTable::size() const {
+        return count;
+    }
+
+    bool ChildTable::empty() const {
+        return count == 0;
+    }
+
+    ChildTable::Layout ChildTable::layout() const {
+        return kind;
+    }
+
+    u64 ChildTable::heapBytes() const {
+        switch (kind) {
+            case Layout::Inline:
+                return 0;
+            case Layout::Sorted:
+                return SortedCapacity * (sizeof(char) + sizeof(NodeIndex));
+            case Layout::Dense:
+                return DenseSize * sizeof(NodeIndex);
+        }
+        return 0;
+    }
+}
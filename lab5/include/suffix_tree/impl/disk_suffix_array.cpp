@@ -0,0 +1,491 @@
+#include "../disk_suffix_array.hpp"
+#include "../mapped_file.hpp"
+#include "../suffix_array.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <queue>
+#include <stdexcept>
+#include <system_error>
+
+namespace lab {
+
+    namespace {
+
+        constexpr char Magic[8] = {'L', 'A', 'B', 'S', 'A', 'I', 'D', 'X'};
+        constexpr u32 ByteOrderMark = 0x01020304;
+        constexpr u64 SectionAlignment = 8;
+
+        // Fixed-size file header, every section is addressed by its offset from the file start
+        struct FileHeader {
+            char magic[8];
+            u32 version;
+            u32 byteOrder;
+            u64 textSize;
+            u64 textOffset;
+            u64 suffixesOffset;
+            u64 fileSize;
+        };
+
+        u64 alignUp(u64 offset) {
+            return (offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+        }
+
+        // Unit of every scratch file read and write
+        constexpr u64 BlockBytes = u64(1) << 16;
+
+        // Suffix at pos with its rank over the first h characters and the rank
+        // of the suffix h characters later: its rank over 2h characters once sorted
+        struct RankPair {
+            u64 first;
+            u64 second;
+            u64 pos;
+        };
+
+        struct NamedSuffix {
+            u64 pos;
+            u64 rank;
+        };
+
+        struct FileCloser {
+            void operator()(std::FILE* file) const {
+                std::fclose(file);
+            }
+        };
+        using FileHandle = std::unique_ptr<std::FILE, FileCloser>;
+
+        // Unbuffered by stdio, the readers and writers move whole blocks
+        FileHandle openFile(const std::string& path, const char* mode) {
+            std::FILE* file = std::fopen(path.c_str(), mode);
+            if (file == nullptr) {
+                throw std::system_error(errno, std::generic_category(), "DiskSuffixArray: cannot open " + path);
+            }
+            std::setvbuf(file, nullptr, _IONBF, 0);
+            return FileHandle(file);
+        }
+
+        template <class Record>
+        class RecordWriter {
+        public:
+            explicit RecordWriter(const std::string& path)
+                :   file(openFile(path, "wb")),
+                    path(path) {
+                buffer.reserve(BlockBytes / sizeof(Record));
+            }
+
+            void push(const Record& record) {
+                buffer.push_back(record);
+                if (buffer.size() == buffer.capacity()) {
+                    flush();
+                }
+            }
+
+            void close() {
+                flush();
+                if (std::fclose(file.release()) != 0) {
+                    throw std::runtime_error("DiskSuffixArray: cannot write " + path);
+                }
+            }
+
+        private:
+            void flush() {
+                if (std::fwrite(buffer.data(), sizeof(Record), buffer.size(), file.get()) != buffer.size()) {
+                    throw std::runtime_error("DiskSuffixArray: cannot write " + path);
+                }
+                buffer.clear();
+            }
+
+            FileHandle file;
+            std::string path;
+            std::vector<Record> buffer;
+        };
+
+        template <class Record>
+        class RecordReader {
+        public:
+            // Starts after the first skip records
+            explicit RecordReader(const std::string& path, u64 skip = 0)
+                :   file(openFile(path, "rb")),
+                    path(path) {
+                if (skip > 0 && ::fseeko(file.get(), static_cast<off_t>(skip * sizeof(Record)), SEEK_SET) != 0) {
+                    throw std::runtime_error("DiskSuffixArray: cannot seek in " + path);
+                }
+                buffer.reserve(BlockBytes / sizeof(Record));
+            }
+
+            bool next(Record& record) {
+                if (position == buffer.size() && !refill()) {
+                    return false;
+                }
+                record = buffer[position++];
+                return true;
+            }
+
+        private:
+            bool refill() {
+                buffer.resize(buffer.capacity());
+                u64 read = std::fread(buffer.data(), sizeof(Record), buffer.size(), file.get());
+                if (std::ferror(file.get())) {
+                    throw std::runtime_error("DiskSuffixArray: cannot read " + path);
+                }
+                buffer.resize(read);
+                position = 0;
+                return read > 0;
+            }
+
+            FileHandle file;
+            std::string path;
+            std::vector<Record> buffer;
+            u64 position = 0;
+        };
+
+        // Scratch files of one build, removed when it ends, however it ends
+        class ScratchFiles {
+        public:
+            explicit ScratchFiles(std::string prefix)
+                :   prefix(std::move(prefix)) {}
+            ScratchFiles(const ScratchFiles&) = delete;
+            ScratchFiles& operator=(const ScratchFiles&) = delete;
+            ~ScratchFiles() {
+                for (const auto& path : paths) {
+                    std::remove(path.c_str());
+                }
+            }
+
+            std::string create(const std::string& name) {
+                paths.push_back(prefix + ".tmp." + name + "." + std::to_string(paths.size()));
+                return paths.back();
+            }
+
+        private:
+            std::string prefix;
+            std::vector<std::string> paths;
+        };
+
+        template <class Record, class Less>
+        std::string mergeRuns(ScratchFiles& scratch, std::span<const std::string> runs, Less less) {
+            std::vector<RecordReader<Record>> readers;
+            readers.reserve(runs.size());
+            for (const auto& run : runs) {
+                readers.emplace_back(run);
+            }
+
+            // Heap of the next record of every run, smallest on top
+            using Head = std::pair<Record, u64>;
+            auto later = [&](const Head& a, const Head& b) {
+                return less(b.first, a.first);
+            };
+            std::priority_queue<Head, std::vector<Head>, decltype(later)> heads(later);
+            for (u64 i = 0; i < readers.size(); ++i) {
+                Record record;
+                if (readers[i].next(record)) {
+                    heads.push({record, i});
+                }
+            }
+
+            std::string merged = scratch.create("merge");
+            RecordWriter<Record> writer(merged);
+            while (!heads.empty()) {
+                auto [record, run] = heads.top();
+                heads.pop();
+                writer.push(record);
+                if (readers[run].next(record)) {
+                    heads.push({record, run});
+                }
+            }
+            writer.close();
+            for (const auto& run : runs) {
+                std::remove(run.c_str());
+            }
+            return merged;
+        }
+
+        // Sorts the records of input into a new scratch file: sorted runs that
+        // fill the budget, then merges of as many runs as one block each allows
+        template <class Record, class Less>
+        std::string externalSort(ScratchFiles& scratch, const std::string& input, u64 memoryBudget, Less less) {
+            u64 runRecords = (memoryBudget - 2 * BlockBytes) / sizeof(Record);
+            u64 fanIn = std::max<u64>(2, memoryBudget / BlockBytes - 1);
+
+            std::vector<std::string> runs;
+            {
+                RecordReader<Record> reader(input);
+                std::vector<Record> run;
+                run.reserve(runRecords);
+                auto writeRun = [&]() {
+                    std::sort(run.begin(), run.end(), less);
+                    runs.push_back(scratch.create("run"));
+                    RecordWriter<Record> writer(runs.back());
+                    for (const auto& record : run) {
+                        writer.push(record);
+                    }
+                    writer.close();
+                    run.clear();
+                };
+                Record record;
+                while (reader.next(record)) {
+                    run.push_back(record);
+                    if (run.size() == runRecords) {
+                        writeRun();
+                    }
+                }
+                if (!run.empty() || runs.empty()) {
+                    writeRun();
+                }
+            }
+            std::remove(input.c_str());
+
+            while (runs.size() > 1) {
+                std::vector<std::string> merged;
+                for (u64 first = 0; first < runs.size(); first += fanIn) {
+                    u64 count = std::min(fanIn, runs.size() - first);
+                    if (count == 1) {
+                        merged.push_back(runs[first]);
+                        continue;
+                    }
+                    merged.push_back(mergeRuns<Record>(scratch, std::span(runs).subspan(first, count), less));
+                }
+                runs.swap(merged);
+            }
+            return runs.front();
+        }
+
+        // Reads the text file, then the terminator if there is one
+        template <class Visitor>
+        void forEachTextByte(const std::string& textPath, std::optional<char> terminator, Visitor&& visit) {
+            RecordReader<char> reader(textPath);
+            char c;
+            while (reader.next(c)) {
+                visit(c);
+            }
+            if (terminator) {
+                visit(*terminator);
+            }
+        }
+    }
+
+    // Prefix doubling over sorted files. The first round ranks the suffixes by
+    // their first InitialDepth characters, read with a rolling window, where
+    // every character counts one more than its byte and the end of the text
+    // counts 0, so that a suffix sorts before its extensions. Each later round
+    // pairs every rank with the rank h positions further (a second sequential
+    // reader over the same file), sorts the pairs and renames them, doubling h,
+    // until every rank is distinct. The suffix positions of the last sorted
+    // pairs are then the suffix array.
+    void DiskSuffixArray::build(const std::string& textPath,
+                                const std::string& indexPath,
+                                u64 memoryBudget,
+                                std::optional<char> terminator) {
+        if (memoryBudget < MinMemoryBudget) {
+            throw std::invalid_argument("DiskSuffixArray: the memory budget must be at least 1 MiB");
+        }
+        constexpr u64 InitialDepth = 7;
+        constexpr u64 Radix = 257;
+        u64 windowTop = 1;
+        for (u64 i = 1; i < InitialDepth; ++i) {
+            windowTop *= Radix;
+        }
+
+        ScratchFiles scratch(indexPath);
+        auto byRanks = [](const RankPair& a, const RankPair& b) {
+            return a.first != b.first ? a.first < b.first : a.second != b.second ? a.second < b.second : a.pos < b.pos;
+        };
+        auto byPosition = [](const NamedSuffix& a, const NamedSuffix& b) {
+            return a.pos < b.pos;
+        };
+
+        u64 size = 0;
+        std::string pairs = scratch.create("pairs");
+        {
+            RecordWriter<RankPair> writer(pairs);
+            u64 window = 0;
+            u64 fed = 0;
+            auto feed = [&](u64 value) {
+                window = window % windowTop * Radix + value;
+                if (fed >= InitialDepth - 1) {
+                    writer.push({window, 0, fed - (InitialDepth - 1)});
+                }
+                ++fed;
+            };
+            forEachTextByte(textPath, terminator, [&](char c) {
+                feed(static_cast<u64>(static_cast<u8>(c)) + 1);
+                ++size;
+            });
+            for (u64 i = 0; i + 1 < InitialDepth; ++i) {
+                feed(0);
+            }
+            writer.close();
+        }
+
+        std::string sorted;
+        for (u64 depth = InitialDepth;; depth *= 2) {
+            sorted = externalSort<RankPair>(scratch, pairs, memoryBudget, byRanks);
+
+            // Rank of a suffix: 1 + the number of suffixes with smaller pairs
+            bool distinct = true;
+            std::string named = scratch.create("named");
+            {
+                RecordReader<RankPair> reader(sorted);
+                RecordWriter<NamedSuffix> writer(named);
+                RankPair pair, previous{};
+                u64 rank = 0;
+                for (u64 index = 0; reader.next(pair); ++index) {
+                    if (index == 0 || pair.first != previous.first || pair.second != previous.second) {
+                        rank = index + 1;
+                    } else {
+                        distinct = false;
+                    }
+                    writer.push({pair.pos, rank});
+                    previous = pair;
+                }
+                writer.close();
+            }
+            if (distinct) {
+                std::remove(named.c_str());
+                break;
+            }
+            std::remove(sorted.c_str());
+
+            std::string byPos = externalSort<NamedSuffix>(scratch, named, memoryBudget, byPosition);
+            pairs = scratch.create("pairs");
+            {
+                RecordReader<NamedSuffix> reader(byPos);
+                RecordReader<NamedSuffix> ahead(byPos, depth);
+                RecordWriter<RankPair> writer(pairs);
+                NamedSuffix suffix, later;
+                while (reader.next(suffix)) {
+                    writer.push({suffix.rank, ahead.next(later) ? later.rank : 0, suffix.pos});
+                }
+                writer.close();
+            }
+            std::remove(byPos.c_str());
+        }
+
+        FileHeader header{};
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = FormatVersion;
+        header.byteOrder = ByteOrderMark;
+        header.textSize = size;
+        header.textOffset = alignUp(sizeof(FileHeader));
+        header.suffixesOffset = alignUp(header.textOffset + size);
+        header.fileSize = header.suffixesOffset + size * sizeof(u64);
+
+        // Header, text, padding and positions, all written in order
+        RecordWriter<char> out(indexPath);
+        auto pad = [&](u64 from, u64 to) {
+            for (u64 i = from; i < to; ++i) {
+                out.push('\0');
+            }
+        };
+        const char* headerBytes = reinterpret_cast<const char*>(&header);
+        for (u64 i = 0; i < sizeof(header); ++i) {
+            out.push(headerBytes[i]);
+        }
+        pad(sizeof(header), header.textOffset);
+        forEachTextByte(textPath, terminator, [&](char c) {
+            out.push(c);
+        });
+        pad(header.textOffset + size, header.suffixesOffset);
+        RecordReader<RankPair> reader(sorted);
+        RankPair pair;
+        while (reader.next(pair)) {
+            const char* bytes = reinterpret_cast<const char*>(&pair.pos);
+            for (u64 i = 0; i < sizeof(u64); ++i) {
+                out.push(bytes[i]);
+            }
+        }
+        out.close();
+    }
+
+    DiskSuffixArray DiskSuffixArray::load(const std::string& path) {
+        auto file = std::make_shared<MappedFile>(path);
+        const char* base = file->getData();
+
+        FileHeader header;
+        if (file->getSize() < sizeof(header)) {
+            throw std::runtime_error("DiskSuffixArray: " + path + " is too small to be an index");
+        }
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+            throw std::runtime_error("DiskSuffixArray: " + path + " is not an index file");
+        }
+        if (header.version != FormatVersion || header.byteOrder != ByteOrderMark) {
+            throw std::runtime_error("DiskSuffixArray: " + path + " has an unsupported version or byte order");
+        }
+
+        auto fits = [&](u64 offset, u64 bytes) {
+            return offset % SectionAlignment == 0 && offset <= header.fileSize && bytes <= header.fileSize - offset;
+        };
+        if (header.fileSize != file->getSize() ||
+            header.textSize > header.fileSize ||
+            !fits(header.textOffset, header.textSize) ||
+            !fits(header.suffixesOffset, header.textSize * sizeof(u64))) {
+            throw std::runtime_error("DiskSuffixArray: " + path + " is truncated or corrupt");
+        }
+
+        DiskSuffixArray array;
+        array.text = std::string_view(base + header.textOffset, header.textSize);
+        array.suffixes = {reinterpret_cast<const u64*>(base + header.suffixesOffset), header.textSize};
+        // One sequential pass: queries index the text with every entry
+        bool inRange = std::all_of(array.suffixes.begin(), array.suffixes.end(), [&](u64 suffix) {
+            return suffix < header.textSize;
+        });
+        if (!inRange) {
+            throw std::runtime_error("DiskSuffixArray: " + path + " has suffix positions out of range");
+        }
+        array.storage = std::move(file);
+        return array;
+    }
+
+    // Binary search for the run of suffixes that start with the pattern
+    DiskSuffixArray::Occurrences DiskSuffixArray::findOccurrences(const std::string& pattern) const {
+        if (pattern.empty()) {
+            return {};
+        }
+        std::string_view view(pattern);
+        auto prefixLess = [&](u64 suffix, std::string_view p) {
+            return text.substr(suffix, p.size()) < p;
+        };
+        auto prefixGreater = [&](std::string_view p, u64 suffix) {
+            return p < text.substr(suffix, p.size());
+        };
+        auto first = std::lower_bound(suffixes.begin(), suffixes.end(), view, prefixLess);
+        auto last = std::upper_bound(first, suffixes.end(), view, prefixGreater);
+        return Occurrences(first, last);
+    }
+
+    u64 DiskSuffixArray::countPattern(const std::string& pattern) const {
+        return findOccurrences(pattern).size();
+    }
+
+    std::set<u64> DiskSuffixArray::searchPattern(const std::string& pattern) const {
+        Occurrences occurrences = findOccurrences(pattern);
+        return std::set<u64>(occurrences.begin(), occurrences.end());
+    }
+
+    std::pair<u64, std::vector<u64>> DiskSuffixArray::findLCS(const std::string& s1, const std::string& s2) {
+        return SuffixArray::findLCS(s1, s2);
+    }
+
+    std::pair<u64, std::set<std::string>> DiskSuffixArray::findLCSString(const std::string& s1, const std::string& s2) {
+        return SuffixArray::findLCSString(s1, s2);
+    }
+
+    u64 DiskSuffixArray::getSuffix(u64 rank) const {
+        return suffixes[rank];
+    }
+
+    std::string_view DiskSuffixArray::getText() const {
+        return text;
+    }
+
+    u64 DiskSuffixArray::getSize() const {
+        return suffixes.size();
+    }
+
+    u64 DiskSuffixArray::memoryUsage() const {
+        return 0;
+    }
+}
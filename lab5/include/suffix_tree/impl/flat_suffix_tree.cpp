@@ -0,0 +1,261 @@
+#include "../flat_suffix_tree.hpp"
+#include "../suffix_tree.hpp"
+#include "../mapped_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace lab {
+
+    namespace {
+
+        constexpr char Magic[8] = {'L', 'A', 'B', 'S', 'T', 'I', 'D', 'X'};
+        constexpr u32 ByteOrderMark = 0x01020304;
+        constexpr u64 SectionAlignment = 8;
+
+        // Fixed-size file header, every section is addressed by its offset from the file start
+        struct FileHeader {
+            char magic[8];
+            u32 version;
+            u32 byteOrder;
+            u64 textSize;
+            u64 nodeCount;
+            u64 leafCount;
+            u64 textOffset;
+            u64 nodesOffset;
+            u64 keysOffset;
+            u64 leavesOffset;
+            u64 fileSize;
+        };
+
+        u64 alignUp(u64 offset) {
+            return (offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+        }
+
+        // Arrays of a flattened tree that lives in memory
+        struct OwnedArrays {
+            std::string text;
+            std::vector<FlatSuffixTree::Node> nodes;
+            std::vector<char> keys;
+            std::vector<u32> leaves;
+        };
+    }
+
+    FlatSuffixTree::FlatSuffixTree(const std::string& text)
+        :   FlatSuffixTree(SuffixTree(text)) {}
+
+    // Lays the tree out breadth-first: the children of a node are appended
+    // together when the node is reached, so they get consecutive indexes
+    FlatSuffixTree::FlatSuffixTree(const SuffixTree& tree) {
+        if (tree.frozen) {
+            *this = *tree.frozen;
+            return;
+        }
+        if (!tree.leafRangesValid()) {
+            throw std::logic_error("FlatSuffixTree: the tree has appended or implicit suffixes, "
+                                   "end the text with a terminator and call reindex()");
+        }
+        auto owned = std::make_shared<OwnedArrays>();
+        owned->text = tree.text.substr(0, tree.size);
+        owned->leaves = tree.leafOrder;
+        owned->nodes.reserve(tree.nodes.size());
+        owned->keys.reserve(tree.nodes.size());
+
+        std::vector<SuffixTree::NodeIndex> order;
+        order.reserve(tree.nodes.size());
+        order.push_back(tree.root);
+        owned->nodes.push_back({0, 0, 0, 0, 0, static_cast<u32>(owned->leaves.size())});
+        owned->keys.push_back('\0');
+
+        for (u64 i = 0; i < order.size(); ++i) {
+            u32 firstChild = static_cast<u32>(owned->nodes.size());
+            u32 leafOffset = owned->nodes[i].leafBegin;
+            tree.forEachChild(order[i], [&](char key, SuffixTree::NodeIndex child) {
+                const SuffixNode& node = tree.nodes[child];
+                u32 count = static_cast<u32>(tree.leafCount(child));
+                owned->nodes.push_back({
+                    static_cast<u32>(node.getStart()),
+                    static_cast<u32>(tree.edgeLength(node)),
+                    0,
+                    0,
+                    leafOffset,
+                    count
+                });
+                owned->keys.push_back(key);
+                order.push_back(child);
+                leafOffset += count;
+            });
+            owned->nodes[i].firstChild = firstChild;
+            owned->nodes[i].childCount = static_cast<u32>(owned->nodes.size()) - firstChild;
+        }
+
+        text = owned->text;
+        nodes = owned->nodes;
+        keys = owned->keys;
+        leaves = owned->leaves;
+        ownedBytes = owned->text.capacity()
+            + owned->nodes.capacity() * sizeof(Node)
+            + owned->keys.capacity()
+            + owned->leaves.capacity() * sizeof(u32);
+        storage = std::move(owned);
+    }
+
+    void FlatSuffixTree::save(const std::string& path) const {
+        FileHeader header{};
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = FormatVersion;
+        header.byteOrder = ByteOrderMark;
+        header.textSize = text.size();
+        header.nodeCount = nodes.size();
+        header.leafCount = leaves.size();
+        header.textOffset = alignUp(sizeof(FileHeader));
+        header.nodesOffset = alignUp(header.textOffset + text.size());
+        header.keysOffset = alignUp(header.nodesOffset + nodes.size_bytes());
+        header.leavesOffset = alignUp(header.keysOffset + keys.size_bytes());
+        header.fileSize = header.leavesOffset + leaves.size_bytes();
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        auto writeAt = [&](u64 offset, const void* data, u64 bytes) {
+            static const char padding[SectionAlignment] = {};
+            u64 position = static_cast<u64>(out.tellp());
+            out.write(padding, static_cast<std::streamsize>(offset - position));
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        };
+        writeAt(0, &header, sizeof(header));
+        writeAt(header.textOffset, text.data(), text.size());
+        writeAt(header.nodesOffset, nodes.data(), nodes.size_bytes());
+        writeAt(header.keysOffset, keys.data(), keys.size_bytes());
+        writeAt(header.leavesOffset, leaves.data(), leaves.size_bytes());
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("FlatSuffixTree: cannot write " + path);
+        }
+    }
+
+    FlatSuffixTree FlatSuffixTree::load(const std::string& path) {
+        auto file = std::make_shared<const MappedFile>(path);
+        const char* base = file->getData();
+
+        FileHeader header;
+        if (file->getSize() < sizeof(header)) {
+            throw std::runtime_error("FlatSuffixTree: " + path + " is too small to be an index");
+        }
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+            throw std::runtime_error("FlatSuffixTree: " + path + " is not an index file");
+        }
+        if (header.version != FormatVersion || header.byteOrder != ByteOrderMark) {
+            throw std::runtime_error("FlatSuffixTree: " + path + " has an unsupported version or byte order");
+        }
+
+        // Counts are bounded by the file size first, so the section sizes cannot overflow
+        auto fits = [&](u64 offset, u64 count, u64 recordSize) {
+            return offset % SectionAlignment == 0 && offset <= header.fileSize
+                && count <= (header.fileSize - offset) / recordSize;
+        };
+        if (header.fileSize != file->getSize() ||
+            header.nodeCount == 0 ||
+            !fits(header.textOffset, header.textSize, 1) ||
+            !fits(header.nodesOffset, header.nodeCount, sizeof(Node)) ||
+            !fits(header.keysOffset, header.nodeCount, 1) ||
+            !fits(header.leavesOffset, header.leafCount, sizeof(u32))) {
+            throw std::runtime_error("FlatSuffixTree: " + path + " is truncated or corrupt");
+        }
+
+        FlatSuffixTree tree;
+        tree.text = std::string_view(base + header.textOffset, header.textSize);
+        tree.nodes = {reinterpret_cast<const Node*>(base + header.nodesOffset), header.nodeCount};
+        tree.keys = {base + header.keysOffset, header.nodeCount};
+        tree.leaves = {reinterpret_cast<const u32*>(base + header.leavesOffset), header.leafCount};
+        if (!tree.recordsValid()) {
+            throw std::runtime_error("FlatSuffixTree: " + path + " has node records out of range");
+        }
+        tree.storage = std::move(file);
+        return tree;
+    }
+
+    // Every edge label lies in the text, every leaf range in the leaves, and
+    // the children of a node come after it in BFS order, so walks stay in
+    // bounds and always move down. A leaf's child range is empty but its
+    // firstChild is still checked, so no record carries an unchecked index
+    bool FlatSuffixTree::recordsValid() const {
+        for (u64 i = 0; i < nodes.size(); ++i) {
+            const Node& node = nodes[i];
+            if (u64(node.start) + node.length > text.size() ||
+                u64(node.leafBegin) + node.leafCount > leaves.size()) {
+                return false;
+            }
+            if (node.firstChild <= i || u64(node.firstChild) + node.childCount > nodes.size()) {
+                return false;
+            }
+        }
+        return std::all_of(leaves.begin(), leaves.end(), [&](u32 suffix) { return suffix < text.size(); });
+    }
+
+    u32 FlatSuffixTree::findLocus(std::string_view pattern) const {
+        u32 current = 0;
+        u64 matched = 0;
+        while (matched < pattern.size()) {
+            // Children keys are contiguous and sorted
+            const Node& node = nodes[current];
+            auto first = keys.begin() + node.firstChild;
+            auto last = first + node.childCount;
+            auto found = std::lower_bound(first, last, pattern[matched]);
+            if (found == last || *found != pattern[matched]) {
+                return NoNode;
+            }
+            current = static_cast<u32>(found - keys.begin());
+
+            // Compare the pattern with the edge label
+            const Node& child = nodes[current];
+            u64 length = std::min<u64>(child.length, pattern.size() - matched);
+            if (text.compare(child.start, length, pattern.substr(matched, length)) != 0) {
+                return NoNode;
+            }
+            matched += length;
+        }
+        return current;
+    }
+
+    FlatSuffixTree::Occurrences FlatSuffixTree::findOccurrences(std::string_view pattern) const {
+        if (pattern.empty()) {
+            return {};
+        }
+        u32 locus = findLocus(pattern);
+        if (locus == NoNode) {
+            return {};
+        }
+        return leaves.subspan(nodes[locus].leafBegin, nodes[locus].leafCount);
+    }
+
+    u64 FlatSuffixTree::countPattern(std::string_view pattern) const {
+        return findOccurrences(pattern).size();
+    }
+
+    std::set<u64> FlatSuffixTree::searchPattern(const std::string& pattern) const {
+        Occurrences occurrences = findOccurrences(pattern);
+        return std::set<u64>(occurrences.begin(), occurrences.end());
+    }
+
+    std::pair<u64, std::vector<u64>> FlatSuffixTree::findLCS(const std::string& s1, const std::string& s2) {
+        return SuffixTree::findLCS(s1, s2);
+    }
+
+    std::pair<u64, std::set<std::string>> FlatSuffixTree::findLCSString(const std::string& s1, const std::string& s2) {
+        return SuffixTree::findLCSString(s1, s2);
+    }
+
+    std::string_view FlatSuffixTree::getText() const {
+        return text;
+    }
+
+    u64 FlatSuffixTree::getNodeCount() const {
+        return nodes.size();
+    }
+
+    u64 FlatSuffixTree::memoryUsage() const {
+        return ownedBytes;
+    }
+}
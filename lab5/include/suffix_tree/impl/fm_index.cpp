@@ -0,0 +1,157 @@
+#include "../fm_index.hpp"
+#include "../suffix_array.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace lab {
+
+    // Row 0 is the empty suffix in front of the sentinel, row r > 0 is the
+    // suffix array entry r - 1. Characters are ranked as unsigned bytes, the
+    // order of SuffixArray::buildSuffixArray.
+    FMIndex::FMIndex(const std::string& text, u32 sampleRate)
+        :   sentinelRow(0),
+            length(text.size()),
+            sampleRate(sampleRate) {
+        if (sampleRate == 0) {
+            throw std::invalid_argument("FMIndex: the sample rate must be positive");
+        }
+
+        codes.fill(NoCode);
+        std::array<u64, 256> frequencies{};
+        for (char c : text) {
+            ++frequencies[static_cast<u8>(c)];
+        }
+        u16 sigma = 0;
+        firstRows.push_back(1);
+        for (u32 c = 0; c < 256; ++c) {
+            if (frequencies[c] > 0) {
+                codes[c] = sigma++;
+                firstRows.push_back(firstRows.back() + frequencies[c]);
+            }
+        }
+
+        std::vector<SuffixArray::Index> suffixes = SuffixArray::buildSuffixArray(text);
+        u64 rows = length + 1;
+        std::vector<u8> symbols(rows);
+        sampled = RankBitVector(rows);
+        auto suffixAt = [&](u64 row) -> u64 {
+            return row == 0 ? length : suffixes[row - 1];
+        };
+        for (u64 row = 0; row < rows; ++row) {
+            u64 suffix = suffixAt(row);
+            if (suffix == 0) {
+                sentinelRow = row;
+                symbols[row] = 0;
+            } else {
+                symbols[row] = static_cast<u8>(codes[static_cast<u8>(text[suffix - 1])]);
+            }
+            if (suffix % sampleRate == 0) {
+                sampled.set(row);
+                samples.push_back(static_cast<Index>(suffix));
+            }
+        }
+        sampled.build();
+        suffixes = {};
+
+        // Codes 0 .. sigma - 1, at least one bit even for a single character
+        u32 largest = sigma > 1 ? sigma - 1u : 1u;
+        u32 bits = static_cast<u32>(std::bit_width(largest));
+        bwt = WaveletMatrix(symbols, bits);
+    }
+
+    u64 FMIndex::rankCode(u8 code, u64 row) const {
+        u64 count = bwt.rank(code, row);
+        // The sentinel is stored as code 0 without being one
+        if (code == 0 && row > sentinelRow) {
+            --count;
+        }
+        return count;
+    }
+
+    u64 FMIndex::lastToFirst(u64 row) const {
+        if (row == sentinelRow) {
+            return 0;
+        }
+        u8 code = bwt.access(row);
+        return firstRows[code] + rankCode(code, row);
+    }
+
+    u64 FMIndex::locate(u64 row) const {
+        u64 steps = 0;
+        while (!sampled[row]) {
+            row = lastToFirst(row);
+            ++steps;
+        }
+        return samples[sampled.rank1(row)] + steps;
+    }
+
+    // Backward search: the range of the suffixes starting with pattern[i..]
+    // shrinks to those preceded by pattern[i - 1]
+    std::pair<u64, u64> FMIndex::findRange(std::string_view pattern) const {
+        u64 begin = 0;
+        u64 end = length + 1;
+        for (u64 i = pattern.size(); i-- > 0 && begin < end;) {
+            u16 code = codes[static_cast<u8>(pattern[i])];
+            if (code == NoCode) {
+                return {0, 0};
+            }
+            u8 symbol = static_cast<u8>(code);
+            begin = firstRows[code] + rankCode(symbol, begin);
+            end = firstRows[code] + rankCode(symbol, end);
+        }
+        return begin < end ? std::pair<u64, u64>{begin, end} : std::pair<u64, u64>{0, 0};
+    }
+
+    u64 FMIndex::countPattern(const std::string& pattern) const {
+        if (pattern.empty()) {
+            return 0;
+        }
+        auto [begin, end] = findRange(pattern);
+        return end - begin;
+    }
+
+    FMIndex::Occurrences FMIndex::findOccurrences(const std::string& pattern) const {
+        thread_local std::vector<Index> located;
+        located.clear();
+        if (pattern.empty()) {
+            return {};
+        }
+        auto [begin, end] = findRange(pattern);
+        for (u64 row = begin; row < end; ++row) {
+            located.push_back(static_cast<Index>(locate(row)));
+        }
+        return located;
+    }
+
+    std::set<u64> FMIndex::searchPattern(const std::string& pattern) const {
+        Occurrences occurrences = findOccurrences(pattern);
+        return std::set<u64>(occurrences.begin(), occurrences.end());
+    }
+
+    // The LCS queries build a throwaway index, the suffix array answers them
+    std::pair<u64, std::vector<u64>> FMIndex::findLCS(const std::string& s1, const std::string& s2) {
+        return SuffixArray::findLCS(s1, s2);
+    }
+
+    std::pair<u64, std::set<std::string>> FMIndex::findLCSString(const std::string& s1, const std::string& s2) {
+        return SuffixArray::findLCSString(s1, s2);
+    }
+
+    u64 FMIndex::getSize() const {
+        return length;
+    }
+
+    u32 FMIndex::getSampleRate() const {
+        return sampleRate;
+    }
+
+    u64 FMIndex::memoryUsage() const {
+        return sizeof(codes)
+            + firstRows.capacity() * sizeof(u64)
+            + bwt.memoryUsage()
+            + sampled.memoryUsage()
+            + samples.capacity() * sizeof(Index);
+    }
+}
@@ -0,0 +1,267 @@
+#include "../generalized_suffix_tree.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace lab {
+
+    using NodeIndex = SuffixTree::NodeIndex;
+
+    namespace {
+
+        Text joinDocuments(const std::vector<std::string>& documents) {
+            std::string joined;
+            for (u64 i = 0; i < documents.size(); ++i) {
+                const std::string& document = documents[i];
+                if (document.find(GeneralizedSuffixTree::Separator) != std::string::npos ||
+                    document.find(GeneralizedSuffixTree::Terminator) != std::string::npos) {
+                    throw std::invalid_argument("GeneralizedSuffixTree: document " + std::to_string(i) +
+                                                " contains a reserved character");
+                }
+                joined += document;
+                if (i + 1 < documents.size()) {
+                    joined += GeneralizedSuffixTree::Separator;
+                }
+            }
+            return Text::copy(joined, GeneralizedSuffixTree::Terminator);
+        }
+    }
+
+    GeneralizedSuffixTree::GeneralizedSuffixTree(const std::vector<std::string>& documents)
+        :   tree(joinDocuments(documents)) {
+        u64 start = 0;
+        for (const std::string& document : documents) {
+            documentStarts.push_back(start);
+            start += document.size() + 1;
+        }
+
+        // Document of every leaf and the link to the previous leaf of that document
+        const std::vector<u32>& leaves = tree.leafOrder;
+        u64 textEnd = tree.text.getBody().size();
+        std::vector<u32> lastLeaf(documents.size(), 0);
+        leafDocuments.resize(leaves.size());
+        previousLeaf.resize(leaves.size());
+        for (u64 i = 0; i < leaves.size(); ++i) {
+            // The terminator suffix belongs to no document
+            u32 document = leaves[i] < textEnd ? documentOf(leaves[i]) : NoDocument;
+            leafDocuments[i] = document;
+            if (document != NoDocument) {
+                previousLeaf[i] = lastLeaf[document];
+                lastLeaf[document] = static_cast<u32>(i + 1);
+            }
+        }
+
+        // Minimum of each block, then doubling ranges of blocks
+        u64 blocks = (leaves.size() + BlockSize - 1) / BlockSize;
+        blockMinima.emplace_back(blocks);
+        for (u64 b = 0; b < blocks; ++b) {
+            u64 end = std::min<u64>(leaves.size(), (b + 1) * BlockSize);
+            auto minimum = std::min_element(previousLeaf.begin() + static_cast<i64>(b * BlockSize),
+                                            previousLeaf.begin() + static_cast<i64>(end));
+            blockMinima[0][b] = static_cast<u32>(minimum - previousLeaf.begin());
+        }
+        for (u64 width = 2; width <= blocks; width *= 2) {
+            const std::vector<u32>& previous = blockMinima.back();
+            std::vector<u32> level(blocks - width + 1);
+            for (u64 b = 0; b < level.size(); ++b) {
+                u32 left = previous[b];
+                u32 right = previous[b + width / 2];
+                level[b] = previousLeaf[right] < previousLeaf[left] ? right : left;
+            }
+            blockMinima.push_back(std::move(level));
+        }
+    }
+
+    u64 GeneralizedSuffixTree::minPreviousLeaf(u64 begin, u64 end) const {
+        auto better = [&](u64 a, u64 b) {
+            return previousLeaf[b] < previousLeaf[a] ? b : a;
+        };
+        auto scan = [&](u64 from, u64 to, u64 best) {
+            for (u64 i = from; i < to; ++i) {
+                best = better(best, i);
+            }
+            return best;
+        };
+
+        u64 firstBlock = begin / BlockSize;
+        u64 lastBlock = (end - 1) / BlockSize;
+        if (firstBlock == lastBlock) {
+            return scan(begin + 1, end, begin);
+        }
+        u64 best = scan(begin + 1, (firstBlock + 1) * BlockSize, begin);
+        best = scan(lastBlock * BlockSize, end, best);
+        if (firstBlock + 1 < lastBlock) {
+            u64 blocks = lastBlock - firstBlock - 1;
+            u64 level = static_cast<u64>(std::bit_width(blocks)) - 1;
+            const std::vector<u32>& minima = blockMinima[level];
+            best = better(best, minima[firstBlock + 1]);
+            best = better(best, minima[lastBlock - (u64(1) << level)]);
+        }
+        return best;
+    }
+
+    std::vector<u32> GeneralizedSuffixTree::findDocuments(const std::string& pattern) const {
+        std::vector<u32> documents;
+        if (pattern.find(Separator) != std::string::npos || pattern.find(Terminator) != std::string::npos) {
+            return documents;
+        }
+        SuffixTree::Occurrences occurrences = tree.findOccurrences(pattern);
+        if (occurrences.size() <= 1) {
+            // A leaf locus is viewed in place rather than in the leaf order
+            for (u32 suffix : occurrences) {
+                documents.push_back(documentOf(suffix));
+            }
+            return documents;
+        }
+
+        // The first leaf of a document in [begin, end) is the one whose previous
+        // leaf lies before begin, and the range minimum always finds one if any is left
+        u64 begin = static_cast<u64>(occurrences.data() - tree.leafOrder.data());
+        std::vector<std::pair<u64, u64>> ranges = {{begin, begin + occurrences.size()}};
+        while (!ranges.empty()) {
+            auto [from, to] = ranges.back();
+            ranges.pop_back();
+            u64 position = minPreviousLeaf(from, to);
+            if (previousLeaf[position] > begin) {
+                continue;
+            }
+            documents.push_back(leafDocuments[position]);
+            if (position + 1 < to) {
+                ranges.emplace_back(position + 1, to);
+            }
+            if (from < position) {
+                ranges.emplace_back(from, position);
+            }
+        }
+        return documents;
+    }
+
+    std::pair<u64, std::set<std::string>> GeneralizedSuffixTree::findLCSString(u64 k) const {
+        if (k == 0) {
+            throw std::invalid_argument("GeneralizedSuffixTree: k must be at least 1");
+        }
+        if (k > documentStarts.size()) {
+            return {0, {}};
+        }
+
+        // Union-find with path compression: a finished node points to its parent,
+        // so the root of a visited leaf is its LCA with the current node
+        std::vector<NodeIndex> ancestor(tree.nodes.size());
+        for (NodeIndex i = 0; i < ancestor.size(); ++i) {
+            ancestor[i] = i;
+        }
+        auto findAncestor = [&](NodeIndex node) {
+            NodeIndex top = node;
+            while (ancestor[top] != top) {
+                top = ancestor[top];
+            }
+            while (ancestor[node] != top) {
+                NodeIndex next = ancestor[node];
+                ancestor[node] = top;
+                node = next;
+            }
+            return top;
+        };
+
+        // Leaves of the same document below each node, summed bottom-up
+        std::vector<u32> duplicates(tree.nodes.size(), 0);
+        std::vector<NodeIndex> lastLeaf(documentStarts.size(), SuffixNode::NoNode);
+        u64 textEnd = tree.text.getBody().size();
+
+        u64 maxLength = 0;
+        std::vector<std::pair<u64, u64>> best;  // Start and length of each longest candidate
+        auto consider = [&](u64 suffix, u64 depth, u64 documents) {
+            u64 length = std::min(depth, lengthInDocument(suffix));
+            if (documents < k || length == 0 || length < maxLength) {
+                return;
+            }
+            if (length > maxLength) {
+                maxLength = length;
+                best.clear();
+            }
+            best.emplace_back(suffix, length);
+        };
+
+        struct Frame {
+            NodeIndex node;
+            NodeIndex parent;
+            u64 depth;
+            bool leaving;
+        };
+        std::vector<Frame> stack = {{tree.root, tree.root, 0, false}};
+        while (!stack.empty()) {
+            Frame frame = stack.back();
+            stack.pop_back();
+            const SuffixNode& node = tree.nodes[frame.node];
+
+            if (node.isLeaf()) {
+                u64 suffix = node.getSuffixIndex();
+                if (suffix < textEnd) {
+                    u32 document = documentOf(suffix);
+                    if (lastLeaf[document] != SuffixNode::NoNode) {
+                        ++duplicates[findAncestor(lastLeaf[document])];
+                    }
+                    lastLeaf[document] = frame.node;
+                    consider(suffix, frame.depth, 1);
+                }
+            } else if (!frame.leaving) {
+                stack.push_back({frame.node, frame.parent, frame.depth, true});
+                tree.forEachChild(frame.node, [&](char, NodeIndex child) {
+                    stack.push_back({child, frame.node, frame.depth + tree.edgeLength(tree.nodes[child]), false});
+                });
+                continue;
+            } else if (frame.node != tree.root) {
+                u64 suffix = tree.leafOrder[tree.leafRanks[node.getChildTable()]];
+                consider(suffix, frame.depth, tree.leafCount(frame.node) - duplicates[frame.node]);
+            }
+
+            if (frame.node != tree.root) {
+                duplicates[frame.parent] += duplicates[frame.node];
+                ancestor[frame.node] = frame.parent;
+            }
+        }
+
+        std::set<std::string> strings;
+        for (auto [start, length] : best) {
+            strings.insert(tree.text.substr(start, length));
+        }
+        return {maxLength, strings};
+    }
+
+    u64 GeneralizedSuffixTree::lengthInDocument(u64 position) const {
+        u32 document = documentOf(position);
+        u64 end = document + 1 < documentStarts.size()
+            ? documentStarts[document + 1] - 1
+            : tree.text.getBody().size();
+        return end - position;
+    }
+
+    u32 GeneralizedSuffixTree::documentOf(u64 position) const {
+        auto next = std::upper_bound(documentStarts.begin(), documentStarts.end(), position);
+        return static_cast<u32>(next - documentStarts.begin()) - 1;
+    }
+
+    const SuffixTree& GeneralizedSuffixTree::getTree() const {
+        return tree;
+    }
+
+    u64 GeneralizedSuffixTree::getDocumentCount() const {
+        return documentStarts.size();
+    }
+
+    u64 GeneralizedSuffixTree::getDocumentStart(u32 document) const {
+        return documentStarts[document];
+    }
+
+    u64 GeneralizedSuffixTree::memoryUsage() const {
+        u64 bytes = tree.memoryUsage()
+            + documentStarts.capacity() * sizeof(u64)
+            + leafDocuments.capacity() * sizeof(u32)
+            + previousLeaf.capacity() * sizeof(u32);
+        for (const std::vector<u32>& level : blockMinima) {
+            bytes += level.capacity() * sizeof(u32);
+        }
+        return bytes;
+    }
+}
@@ -0,0 +1,57 @@
+#include "../mapped_file.hpp"
+
+#include <cerrno>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace lab {
+
+    MappedFile::MappedFile(const std::string& path)
+        :   address(nullptr),
+            size(0) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "MappedFile: cannot open " + path);
+        }
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "MappedFile: cannot stat " + path);
+        }
+        size = static_cast<u64>(info.st_size);
+
+        // Empty files cannot be mapped, they are represented by a null address
+        if (size > 0) {
+            address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address == MAP_FAILED) {
+                int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "MappedFile: cannot map " + path);
+            }
+        }
+        ::close(fd);
+    }
+
+    MappedFile::~MappedFile() {
+        if (size > 0) {
+            ::munmap(address, size);
+        }
+    }
+
+    const char* MappedFile::getData() const {
+        return static_cast<const char*>(address);
+    }
+
+    u64 MappedFile::getSize() const {
+        return size;
+    }
+
+    std::string_view MappedFile::getView() const {
+        return {getData(), size};
+    }
+}
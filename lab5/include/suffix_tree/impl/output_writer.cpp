@@ -0,0 +1,114 @@
+#include "../output_writer.hpp"
+
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <unistd.h>
+
+namespace lab {
+
+    namespace {
+        // "00" to "99", the digit pairs of every value below 100
+        constexpr std::array<char, 200> DigitPairs = []() {
+            std::array<char, 200> pairs{};
+            for (u64 i = 0; i < 100; ++i) {
+                pairs[2 * i] = static_cast<char>('0' + i / 10);
+                pairs[2 * i + 1] = static_cast<char>('0' + i % 10);
+            }
+            return pairs;
+        }();
+
+        // Smallest value with i + 1 digits: 0, then 10^i
+        constexpr std::array<u64, MaxDecimalDigits> DigitThresholds = []() {
+            std::array<u64, MaxDecimalDigits> thresholds{};
+            u64 power = 10;
+            for (u64 i = 1; i < MaxDecimalDigits; ++i) {
+                thresholds[i] = power;
+                power *= 10;
+            }
+            return thresholds;
+        }();
+    }
+
+    // Digit count from the bit length (1233 / 4096 ~ log10(2)), corrected by
+    // one comparison, then the digits are written from the back two at a time
+    u64 formatDecimal(u64 value, char* out) {
+        u64 bits = static_cast<u64>(64 - std::countl_zero(value | 1));
+        u64 length = (bits * 1233 >> 12) + 1;
+        length -= value < DigitThresholds[length - 1];
+
+        char* end = out + length;
+        while (value >= 100) {
+            end -= 2;
+            std::memcpy(end, &DigitPairs[value % 100 * 2], 2);
+            value /= 100;
+        }
+        if (value >= 10) {
+            std::memcpy(end - 2, &DigitPairs[value * 2], 2);
+        } else {
+            end[-1] = static_cast<char>('0' + value);
+        }
+        return length;
+    }
+
+    void appendDecimal(std::string& out, u64 value) {
+        char digits[MaxDecimalDigits];
+        out.append(digits, formatDecimal(value, digits));
+    }
+
+    OutputWriter::OutputWriter(int fd, u64 capacity)
+        :   fd(fd),
+            capacity(capacity) {
+        buffer.reserve(capacity);
+    }
+
+    void OutputWriter::write(std::string_view text) {
+        if (buffer.size() + text.size() > capacity) {
+            flush();
+        }
+        if (text.size() > capacity) {
+            writeAll(text.data(), text.size());
+            return;
+        }
+        buffer += text;
+    }
+
+    void OutputWriter::writeDecimal(u64 value) {
+        if (buffer.size() + MaxDecimalDigits > capacity) {
+            flush();
+        }
+        appendDecimal(buffer, value);
+    }
+
+    void OutputWriter::flush() {
+        // The buffer is dropped even when the write fails, so that a retry
+        // does not repeat what may have been written
+        try {
+            writeAll(buffer.data(), buffer.size());
+        } catch (...) {
+            buffer.clear();
+            throw;
+        }
+        buffer.clear();
+    }
+
+    void OutputWriter::writeAll(const char* data, u64 size) {
+        while (size > 0) {
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(), "OutputWriter: cannot write");
+            }
+            data += written;
+            size -= static_cast<u64>(written);
+        }
+    }
+
+    u64 OutputWriter::pending() const {
+        return buffer.size();
+    }
+}
@@ -0,0 +1,82 @@
+#include "../query_cache.hpp"
+
+namespace lab {
+
+    QueryCache::QueryCache(u64 byteBudget)
+        :   byteBudget(byteBudget) {}
+
+    QueryCache::Positions QueryCache::find(const std::string& pattern, u64 version) {
+        std::lock_guard lock(mutex);
+        if (version != this->version) {
+            dropAll();
+            this->version = version;
+        }
+        auto found = index.find(pattern);
+        if (found == index.end()) {
+            ++counters.misses;
+            return nullptr;
+        }
+        ++counters.hits;
+        entries.splice(entries.begin(), entries, found->second);
+        return found->second->positions;
+    }
+
+    // Another thread may have stored the same pattern meanwhile, or moved the
+    // cache to a newer version; both results are then left as they are
+    void QueryCache::insert(const std::string& pattern, u64 version, Positions positions) {
+        u64 bytes = EntryOverhead + pattern.size() + positions->size() * sizeof(u64);
+        std::lock_guard lock(mutex);
+        if (version != this->version || bytes > byteBudget || index.contains(pattern)) {
+            return;
+        }
+        while (counters.bytes + bytes > byteBudget) {
+            const Entry& last = entries.back();
+            counters.bytes -= last.bytes;
+            index.erase(last.pattern);
+            entries.pop_back();
+            ++counters.evictions;
+        }
+        entries.push_front({pattern, std::move(positions), bytes});
+        index.emplace(entries.front().pattern, entries.begin());
+        counters.bytes += bytes;
+    }
+
+    void QueryCache::dropAll() {
+        if (!entries.empty()) {
+            ++counters.invalidations;
+        }
+        index.clear();
+        entries.clear();
+        counters.bytes = 0;
+    }
+
+    void QueryCache::clear() {
+        std::lock_guard lock(mutex);
+        index.clear();
+        entries.clear();
+        counters.bytes = 0;
+    }
+
+    QueryCache::Stats QueryCache::stats() const {
+        std::lock_guard lock(mutex);
+        Stats stats = counters;
+        stats.entries = entries.size();
+        return stats;
+    }
+
+    u64 QueryCache::getByteBudget() const {
+        return byteBudget;
+    }
+
+    std::ostream& operator<<(std::ostream& os, const QueryCache::Stats& stats) {
+        u64 lookups = stats.hits + stats.misses;
+        os << "cache hits:          " << stats.hits << "\n"
+           << "cache misses:        " << stats.misses << "\n"
+           << "cache hit rate:      " << (lookups == 0 ? 0.0 : static_cast<double>(stats.hits) / static_cast<double>(lookups)) << "\n"
+           << "cache evictions:     " << stats.evictions << "\n"
+           << "cache invalidations: " << stats.invalidations << "\n"
+           << "cache entries:       " << stats.entries << "\n"
+           << "cache bytes:         " << stats.bytes << "\n";
+        return os;
+    }
+}
@@ -0,0 +1,322 @@
+#include "../suffix_array.hpp"
+#include "../parallel_for.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace lab {
+
+    namespace {
+
+        using Index = SuffixArray::Index;
+
+        constexpr Index None = limit<Index>::max();
+
+        // Direct comparison sort for tiny inputs
+        template <class Symbol>
+        std::vector<Index> naiveSuffixArray(const Symbol* s, Index n) {
+            std::vector<Index> sa(n);
+            for (Index i = 0; i < n; ++i) {
+                sa[i] = i;
+            }
+            std::sort(sa.begin(), sa.end(), [&](Index l, Index r) {
+                while (l < n && r < n) {
+                    if (s[l] != s[r]) {
+                        return s[l] < s[r];
+                    }
+                    ++l;
+                    ++r;
+                }
+                return l == n;
+            });
+            return sa;
+        }
+
+        // SA-IS (Nong, Zhang, Chan) over symbols in [0, upper]
+        template <class Symbol>
+        std::vector<Index> saIs(const Symbol* s, Index n, Index upper) {
+            if (n < 10) {
+                return naiveSuffixArray(s, n);
+            }
+
+            std::vector<Index> sa(n);
+
+            // ls[i]: suffix i is S-type (smaller than suffix i + 1)
+            std::vector<bool> ls(n);
+            for (Index i = n - 1; i-- > 0;) {
+                ls[i] = (s[i] == s[i + 1]) ? ls[i + 1] : (s[i] < s[i + 1]);
+            }
+
+            // Bucket boundaries: sumL[c] is the start of bucket c, sumS[c] is the start of its S part
+            std::vector<Index> sumL(upper + 2), sumS(upper + 2);
+            for (Index i = 0; i < n; ++i) {
+                if (!ls[i]) {
+                    sumS[s[i]]++;
+                } else {
+                    sumL[s[i] + 1]++;
+                }
+            }
+            for (Index i = 0; i <= upper; ++i) {
+                sumS[i] += sumL[i];
+                sumL[i + 1] += sumS[i];
+            }
+
+            auto induce = [&](const std::vector<Index>& lms) {
+                std::fill(sa.begin(), sa.end(), None);
+                std::vector<Index> bucket(sumS);
+                for (Index d : lms) {
+                    sa[bucket[s[d]]++] = d;
+                }
+                std::copy(sumL.begin(), sumL.end(), bucket.begin());
+                sa[bucket[s[n - 1]]++] = n - 1;
+                for (Index i = 0; i < n; ++i) {
+                    Index v = sa[i];
+                    if (v != None && v >= 1 && !ls[v - 1]) {
+                        sa[bucket[s[v - 1]]++] = v - 1;
+                    }
+                }
+                std::copy(sumL.begin(), sumL.end(), bucket.begin());
+                for (Index i = n; i-- > 0;) {
+                    Index v = sa[i];
+                    if (v != None && v >= 1 && ls[v - 1]) {
+                        sa[--bucket[s[v - 1] + 1]] = v - 1;
+                    }
+                }
+            };
+
+            // Left-most S-type positions and their order of appearance
+            std::vector<Index> lmsMap(n + 1, None);
+            std::vector<Index> lms;
+            for (Index i = 1; i < n; ++i) {
+                if (!ls[i - 1] && ls[i]) {
+                    lmsMap[i] = static_cast<Index>(lms.size());
+                    lms.push_back(i);
+                }
+            }
+            Index m = static_cast<Index>(lms.size());
+
+            induce(lms);
+
+            if (m > 0) {
+                std::vector<Index> sortedLms;
+                sortedLms.reserve(m);
+                for (Index v : sa) {
+                    if (lmsMap[v] != None) {
+                        sortedLms.push_back(v);
+                    }
+                }
+
+                // Name LMS substrings, equal substrings get equal names
+                std::vector<Index> reduced(m);
+                Index reducedUpper = 0;
+                reduced[lmsMap[sortedLms[0]]] = 0;
+                for (Index i = 1; i < m; ++i) {
+                    Index l = sortedLms[i - 1];
+                    Index r = sortedLms[i];
+                    Index endL = (lmsMap[l] + 1 < m) ? lms[lmsMap[l] + 1] : n;
+                    Index endR = (lmsMap[r] + 1 < m) ? lms[lmsMap[r] + 1] : n;
+                    bool same = true;
+                    if (endL - l != endR - r) {
+                        same = false;
+                    } else {
+                        while (l < endL && s[l] == s[r]) {
+                            ++l;
+                            ++r;
+                        }
+                        if (l == n || s[l] != s[r]) {
+                            same = false;
+                        }
+                    }
+                    if (!same) {
+                        ++reducedUpper;
+                    }
+                    reduced[lmsMap[sortedLms[i]]] = reducedUpper;
+                }
+
+                // Sort the reduced problem and induce the full order from it
+                auto reducedSa = saIs(reduced.data(), m, reducedUpper);
+                for (Index i = 0; i < m; ++i) {
+                    sortedLms[i] = lms[reducedSa[i]];
+                }
+                induce(sortedLms);
+            }
+            return sa;
+        }
+    }
+
+    SuffixArray::SuffixArray(const std::string& text)
+        :   text(text),
+            suffixes(buildSuffixArray(text)),
+            lcp(buildLcpArray(text, suffixes)) {}
+
+    std::vector<SuffixArray::Index> SuffixArray::buildSuffixArray(std::string_view text) {
+        if (text.size() >= None) {
+            throw std::length_error("SuffixArray: text is too long for 32-bit suffix indices");
+        }
+        const u8* symbols = reinterpret_cast<const u8*>(text.data());
+        return saIs(symbols, static_cast<Index>(text.size()), limit<u8>::max());
+    }
+
+    // Kasai et al. linear-time LCP construction
+    std::vector<SuffixArray::Index> SuffixArray::buildLcpArray(std::string_view text, const std::vector<Index>& suffixes, u32 threads) {
+        constexpr u64 ChunksPerThread = 4;
+        u64 n = suffixes.size();
+        u64 chunks = threads > 1 ? threads * ChunksPerThread : 1;
+        u64 chunkSize = (n + chunks - 1) / std::max<u64>(chunks, 1);
+        auto chunkEnd = [&](u64 chunk) {
+            return std::min(n, (chunk + 1) * chunkSize);
+        };
+
+        std::vector<Index> rank(n);
+        parallelFor(chunks, threads, [&](u64 chunk) {
+            for (u64 i = chunk * chunkSize; i < chunkEnd(chunk); ++i) {
+                rank[suffixes[i]] = static_cast<Index>(i);
+            }
+        });
+
+        // h only carries a lower bound from one text position to the next, so
+        // every chunk may start its scan from 0
+        std::vector<Index> lcp(n, 0);
+        parallelFor(chunks, threads, [&](u64 chunk) {
+            u64 h = 0;
+            for (u64 i = chunk * chunkSize; i < chunkEnd(chunk); ++i) {
+                if (rank[i] == 0) {
+                    h = 0;
+                    continue;
+                }
+                u64 j = suffixes[rank[i] - 1];
+                while (i + h < n && j + h < n && text[i + h] == text[j + h]) {
+                    ++h;
+                }
+                lcp[rank[i]] = static_cast<Index>(h);
+                if (h > 0) {
+                    --h;
+                }
+            }
+        });
+        return lcp;
+    }
+
+    std::pair<u64, u64> SuffixArray::findRange(std::string_view pattern) const {
+        std::string_view view(text);
+        auto prefixLess = [&](Index suffix, std::string_view p) {
+            return view.substr(suffix, p.size()) < p;
+        };
+        auto prefixGreater = [&](std::string_view p, Index suffix) {
+            return p < view.substr(suffix, p.size());
+        };
+        auto begin = std::lower_bound(suffixes.begin(), suffixes.end(), pattern, prefixLess);
+        auto end = std::upper_bound(begin, suffixes.end(), pattern, prefixGreater);
+        return {
+            static_cast<u64>(begin - suffixes.begin()),
+            static_cast<u64>(end - suffixes.begin())
+        };
+    }
+
+    // Searches for a pattern with two binary searches over the suffix array
+    std::set<u64> SuffixArray::searchPattern(const std::string& pattern) const {
+        if (pattern == "") {
+            return {};
+        }
+        auto [begin, end] = findRange(pattern);
+        std::set<u64> indexes;
+        for (u64 i = begin; i < end; ++i) {
+            indexes.insert(suffixes[i]);
+        }
+        return indexes;
+    }
+
+    SuffixArray::Occurrences SuffixArray::findOccurrences(const std::string& pattern) const {
+        if (pattern == "") {
+            return {};
+        }
+        auto [begin, end] = findRange(pattern);
+        return Occurrences(suffixes).subspan(begin, end - begin);
+    }
+
+    // Counts occurrences as the size of the matching rank range
+    u64 SuffixArray::countPattern(const std::string& pattern) const {
+        if (pattern == "") {
+            return 0;
+        }
+        auto [begin, end] = findRange(pattern);
+        return end - begin;
+    }
+
+    // Scans adjacent suffixes coming from different strings of s1 + "#" + s2 + "$".
+    // Returns the LCS length and the left-most start of every distinct LCS.
+    std::pair<u64, std::vector<u64>> SuffixArray::findLCSPositions(const std::string& s1, const std::string& s2) {
+        SuffixArray array(s1 + "#" + s2 + "$");
+        u64 splitPoint = s1.size();
+        auto side = [&](u64 suffix) {
+            return suffix < splitPoint ? 1 : suffix > splitPoint ? 2 : 0;
+        };
+
+        u64 maxLength = 0;
+        for (u64 i = 1; i < array.suffixes.size(); ++i) {
+            int a = side(array.suffixes[i - 1]);
+            int b = side(array.suffixes[i]);
+            if (a != 0 && b != 0 && a != b) {
+                maxLength = std::max<u64>(maxLength, array.lcp[i]);
+            }
+        }
+        if (maxLength == 0) {
+            return {0, {}};
+        }
+
+        // Every maximal run of ranks sharing maxLength characters is one candidate substring
+        std::vector<u64> indexes;
+        u64 n = array.suffixes.size();
+        for (u64 begin = 0; begin < n;) {
+            u64 end = begin + 1;
+            while (end < n && array.lcp[end] >= maxLength) {
+                ++end;
+            }
+            bool inS1 = false;
+            bool inS2 = false;
+            u64 leftmost = limit<u64>::max();
+            for (u64 i = begin; i < end; ++i) {
+                inS1 |= side(array.suffixes[i]) == 1;
+                inS2 |= side(array.suffixes[i]) == 2;
+                leftmost = std::min<u64>(leftmost, array.suffixes[i]);
+            }
+            if (inS1 && inS2) {
+                indexes.push_back(leftmost);
+            }
+            begin = end;
+        }
+        std::sort(indexes.begin(), indexes.end());
+        return {maxLength, indexes};
+    }
+
+    std::pair<u64, std::vector<u64>> SuffixArray::findLCS(const std::string& s1, const std::string& s2) {
+        return findLCSPositions(s1, s2);
+    }
+
+    std::pair<u64, std::set<std::string>> SuffixArray::findLCSString(const std::string& s1, const std::string& s2) {
+        auto [maxLength, indexes] = findLCSPositions(s1, s2);
+        std::set<std::string> lcs;
+        for (u64 start : indexes) {
+            lcs.insert(s1.substr(start, maxLength));
+        }
+        return {maxLength, lcs};
+    }
+
+    u64 SuffixArray::getSuffix(u64 rank) const {
+        return suffixes[rank];
+    }
+
+    u64 SuffixArray::getLcp(u64 rank) const {
+        return lcp[rank];
+    }
+
+    u64 SuffixArray::getSize() const {
+        return suffixes.size();
+    }
+
+    u64 SuffixArray::memoryUsage() const {
+        return text.capacity()
+            + suffixes.capacity() * sizeof(Index)
+            + lcp.capacity() * sizeof(Index);
+    }
+}
@@ -4,41 +4,48 @@ namespace lab {
 
     SuffixNode::SuffixNode() 
         :   start(0ul), 
-            end(nullptr), 
-            suffixLink(nullptr), 
-            suffixIndex(limit<u64>::max()) {}
+            end(OpenEnd), 
+            suffixLink(NoNode), 
+            childTable(NoTable), 
+            suffixIndex(NoSuffix) {}
 
-    SuffixNode::SuffixNode(u64 start, U64Ptr end)
+    SuffixNode::SuffixNode(u64 start, u64 end)
         :   start(start), 
             end(end), 
-            suffixLink(nullptr), 
-            suffixIndex(limit<u64>::max()) {}
+            suffixLink(NoNode), 
+            childTable(NoTable), 
+            suffixIndex(NoSuffix) {}
 
     u64 SuffixNode::getStart() const {
         return start;
     }
 
-    u64 SuffixNode::getEnd() const {
-        return end ? *end : 0;
+    u64 SuffixNode::getEnd(u64 leafEnd) const {
+        return end == OpenEnd ? leafEnd : end;
     }
 
-    SuffixNode::ChildrenMap& SuffixNode::getChildren() {
-        return children;
+    SuffixNode::TableIndex SuffixNode::getChildTable() const {
+        return childTable;
     }
 
-    SuffixNode::SuffixNodePtr SuffixNode::getSuffixLink() {
+    bool SuffixNode::isLeaf() const {
+        return childTable == NoTable;
+    }
+
+    SuffixNode::NodeIndex SuffixNode::getSuffixLink() const {
         return suffixLink;
     }
 
-    void SuffixNode::setSuffixLink(SuffixNodePtr node) {
+    void SuffixNode::setSuffixLink(NodeIndex node) {
         suffixLink = node;
     }
 
     void SuffixNode::setSuffixIndex(u64 index) {
-        suffixIndex = index;
+        suffixIndex = static_cast<u32>(index);
     }
 
+    // Returns limit<u64>::max() for nodes that are not leaves
     u64 SuffixNode::getSuffixIndex() const {
-        return suffixIndex;
+        return suffixIndex == NoSuffix ? limit<u64>::max() : suffixIndex;
     }
 }
@@ -1,45 +1,400 @@
 #include "../suffix_tree.hpp"
+#include "../flat_suffix_tree.hpp"
+#include "../suffix_array.hpp"
+#include "../parallel_for.hpp"
 
-#include <queue>
-#include <functional>
+#include <algorithm>
 #include <iostream>
+#include <optional>
+#include <tuple>
+#include <stdexcept>
 
 namespace lab {
 
     SuffixTree::SuffixTree(const std::string& text) 
-        :   text(std::make_shared<std::string>(text)), 
-            size(text.size()) {
-        buildTree(text);
+        :   SuffixTree(Text::copy(text)) {}
+
+    SuffixTree::SuffixTree(Text text) 
+        :   text(std::move(text)), 
+            size(this->text.size()) {
+        build();
+    }
+
+    SuffixTree::SuffixTree(Text text, u32 threads)
+        :   text(std::move(text)),
+            size(this->text.size()) {
+        // Without a unique last character Ukkonen leaves some suffixes implicit,
+        // which a tree built from the suffix array cannot reproduce
+        std::string_view body = this->text.getBody();
+        bool uniqueEnd = this->text.getTerminator()
+            ? body.find(*this->text.getTerminator()) == std::string_view::npos
+            : !body.empty() && body.find(body.back()) == body.size() - 1;
+        if (threads > 1 && uniqueEnd) {
+            buildFromSuffixArray(threads);
+        } else {
+            build();
+        }
     }
 
     void SuffixTree::buildTree(const std::string& text) {
-        root = std::make_shared<SuffixNode>(
-            limit<u64>::max(), 
-            std::make_shared<u64>(limit<u64>::max())
-        );
+        requireArena("buildTree");
+        this->text = Text::copy(text);
+        size = this->text.size();
+        build();
+        ++version;
+    }
+
+    void SuffixTree::build() {
+        // A tree over n characters has at most 2n nodes, reserve them up front
+        // so that the arena never reallocates during construction
+        if (2 * size + 1 >= SuffixNode::NoNode) {
+            throw std::length_error("SuffixTree: text is too long for 32-bit node indices");
+        }
+        nodes.clear();
+        nodes.reserve(2 * size + 1);
+        tables.clear();
+        tables.reserve(size + 1);
+
+        root = newNode(limit<u64>::max(), SuffixNode::OpenEnd);
         activeNode = root;
         activeEdge = limit<u64>::max();
         activeLength = 0;
         remainingSuffixCount = 0;
-        leafEnd = std::make_shared<u64>(limit<u64>::max());
-        rootEnd = nullptr;
-        splitEnd = nullptr;
-        
-        for (u64 i = 0; i < size; ++i) {
+        leafEnd = limit<u64>::max();
+        counters = {};
+
+        {
+            PhaseTimer timer(counters, "ukkonen");
+            for (u64 i = 0; i < size; ++i) {
+                extendTree(i);
+            }
+        }
+        PhaseTimer timer(counters, "leaf index");
+        indexLeaves();
+    }
+
+    void SuffixTree::append(char c) {
+        append(std::string_view(&c, 1));
+    }
+
+    void SuffixTree::append(std::string_view more) {
+        requireArena("append");
+        if (2 * (size + more.size()) + 1 >= SuffixNode::NoNode) {
+            throw std::length_error("SuffixTree: text is too long for 32-bit node indices");
+        }
+        PhaseTimer timer(counters, "append");
+        text.append(more);
+        for (u64 i = size; i < text.size(); ++i) {
             extendTree(i);
         }
-        
-        setSuffixIndexByDFS(root, 0);
+        size = text.size();
+        ++version;
+    }
+
+    void SuffixTree::reindex() {
+        requireArena("reindex");
+        PhaseTimer timer(counters, "leaf index");
+        indexLeaves();
+    }
+
+    // The flat layout keeps its own copy of the text, so everything the tree
+    // held goes. The shape is measured first and kept with the construction
+    // counters, which is what stats() reports from then on.
+    void SuffixTree::freeze() {
+        requireArena("freeze");
+        PhaseTimer timer(counters, "freeze");
+        TreeStats shape = stats();
+        frozen = std::make_shared<const FlatSuffixTree>(*this);
+        counters.nodes = shape.nodes;
+        counters.leaves = shape.leaves;
+        counters.maxDepth = shape.maxDepth;
+        nodes = std::vector<SuffixNode>();
+        tables = std::vector<ChildTable>();
+        leafCounts = std::vector<u32>();
+        leafOrder = std::vector<u32>();
+        leafRanks = std::vector<u32>();
+        text = Text();
+    }
+
+    bool SuffixTree::isFrozen() const {
+        return frozen != nullptr;
+    }
+
+    void SuffixTree::requireArena(const char* operation) const {
+        if (frozen) {
+            throw std::logic_error(std::string("SuffixTree: ") + operation + " is not available on a frozen tree");
+        }
+    }
+
+    u64 SuffixTree::getVersion() const {
+        return version;
+    }
+
+    // Converts the suffix array into the tree with the classic stack over the
+    // rightmost path: each suffix pops the nodes deeper than its LCP with the
+    // previous one and may split off a node at exactly that depth. Ukkonen
+    // gives an edge the start of the first suffix inserted below it, which is
+    // the smallest suffix of the subtree, so each edge starts at that suffix
+    // plus the depth of its parent and both builders produce the same tree.
+    //
+    // The array is cut where the LCP drops below SegmentDepth. Segments share
+    // no node deeper than that, so they are converted concurrently into
+    // preallocated slices of the arena, and their tops are then joined below
+    // the root by the same stack.
+    void SuffixTree::buildFromSuffixArray(u32 threads) {
+        constexpr u64 SegmentDepth = 4;
+
+        if (2 * size + 1 >= SuffixNode::NoNode) {
+            throw std::length_error("SuffixTree: text is too long for 32-bit node indices");
+        }
+        counters = {};
+        std::string materialised;
+        std::string_view view = text.getBody();
+        if (text.getTerminator()) {
+            materialised = text.substr(0, size);
+            view = materialised;
+        }
+        std::vector<u32> suffixes;
+        std::vector<u32> lcp;
+        {
+            PhaseTimer timer(counters, "suffix array");
+            suffixes = SuffixArray::buildSuffixArray(view);
+        }
+        {
+            PhaseTimer timer(counters, "lcp");
+            lcp = SuffixArray::buildLcpArray(view, suffixes, threads);
+        }
+        std::optional<PhaseTimer> convertTimer(std::in_place, counters, "convert");
+
+        std::vector<u64> segments;
+        for (u64 i = 0; i < size; ++i) {
+            if (i == 0 || lcp[i] < SegmentDepth) {
+                segments.push_back(i);
+            }
+        }
+        segments.push_back(size);
+        u64 segmentCount = segments.size() - 1;
+
+        // Internal nodes of every segment, counted by replaying the stack on depths
+        std::vector<u64> internalCounts(segmentCount, 0);
+        parallelFor(segmentCount, threads, [&](u64 segment) {
+            std::vector<u64> depths = {0};
+            for (u64 i = segments[segment]; i < segments[segment + 1]; ++i) {
+                u64 h = i == segments[segment] ? 0 : lcp[i];
+                while (depths.back() > h) {
+                    depths.pop_back();
+                    if (depths.back() < h) {
+                        ++internalCounts[segment];
+                        depths.push_back(h);
+                    }
+                }
+                depths.push_back(size - suffixes[i]);
+            }
+        });
+
+        // Arena slices: the root first, then each segment's leaves and internal nodes
+        std::vector<u64> nodeOffsets(segmentCount + 1, 1);
+        std::vector<u64> tableOffsets(segmentCount + 1, 1);
+        for (u64 segment = 0; segment < segmentCount; ++segment) {
+            u64 leaves = segments[segment + 1] - segments[segment];
+            nodeOffsets[segment + 1] = nodeOffsets[segment] + leaves + internalCounts[segment];
+            tableOffsets[segment + 1] = tableOffsets[segment] + internalCounts[segment];
+        }
+        nodes.clear();
+        nodes.reserve(2 * size + 1);
+        nodes.resize(nodeOffsets[segmentCount]);
+        tables.clear();
+        tables.reserve(size + 1);
+        tables.resize(tableOffsets[segmentCount]);
+
+        root = 0;
+        nodes[root] = SuffixNode(limit<u64>::max(), SuffixNode::OpenEnd);
+        nodes[root].childTable = 0;
+        leafEnd = size - 1;
+
+        struct Entry {
+            NodeIndex node;
+            u64 depth;
+            u64 minSuffix;  // Smallest suffix below the node
+        };
+        auto attach = [&](Entry& parent, const Entry& child) {
+            parent.minSuffix = std::min(parent.minSuffix, child.minSuffix);
+            if (parent.node == SuffixNode::NoNode) {
+                return;
+            }
+            SuffixNode& node = nodes[child.node];
+            node.start = child.minSuffix + parent.depth;
+            if (!node.isLeaf()) {
+                node.end = child.minSuffix + child.depth - 1;
+            }
+            tables[nodes[parent.node].childTable].set(text[node.start], child.node);
+        };
+        auto push = [&](std::vector<Entry>& stack, Entry entry, u64 h, auto&& newInternal) {
+            while (stack.back().depth > h) {
+                Entry child = stack.back();
+                stack.pop_back();
+                if (stack.back().depth < h) {
+                    stack.push_back({newInternal(), h, limit<u64>::max()});
+                }
+                attach(stack.back(), child);
+            }
+            stack.push_back(entry);
+        };
+
+        // Every segment becomes one subtree below a placeholder parent
+        std::vector<Entry> tops(segmentCount);
+        parallelFor(segmentCount, threads, [&](u64 segment) {
+            u64 begin = segments[segment];
+            u64 end = segments[segment + 1];
+            u64 nextNode = nodeOffsets[segment] + (end - begin);
+            u64 nextTable = tableOffsets[segment];
+            auto newInternal = [&]() {
+                NodeIndex index = static_cast<NodeIndex>(nextNode++);
+                nodes[index] = SuffixNode(0, 0);
+                nodes[index].childTable = static_cast<SuffixNode::TableIndex>(nextTable++);
+                return index;
+            };
+
+            std::vector<Entry> stack = {{SuffixNode::NoNode, 0, limit<u64>::max()}};
+            for (u64 i = begin; i < end; ++i) {
+                NodeIndex leaf = static_cast<NodeIndex>(nodeOffsets[segment] + (i - begin));
+                nodes[leaf] = SuffixNode(0, SuffixNode::OpenEnd);
+                nodes[leaf].setSuffixIndex(suffixes[i]);
+                push(stack, {leaf, size - suffixes[i], suffixes[i]}, i == begin ? 0 : lcp[i], newInternal);
+            }
+            while (stack.size() > 2) {
+                Entry child = stack.back();
+                stack.pop_back();
+                attach(stack.back(), child);
+            }
+            tops[segment] = stack[1];
+        });
+
+        // Join the segments below the root, the nodes above them are few
+        auto newSkeletonNode = [&]() {
+            NodeIndex index = newNode(0, 0);
+            tables.emplace_back();
+            nodes[index].childTable = static_cast<SuffixNode::TableIndex>(tables.size() - 1);
+            return index;
+        };
+        std::vector<Entry> stack = {{root, 0, limit<u64>::max()}};
+        for (u64 segment = 0; segment < segmentCount; ++segment) {
+            push(stack, tops[segment], segment == 0 ? 0 : lcp[segments[segment]], newSkeletonNode);
+        }
+        while (stack.size() > 1) {
+            Entry child = stack.back();
+            stack.pop_back();
+            attach(stack.back(), child);
+        }
+
+        // Every suffix is a leaf, as after Ukkonen's last phase
+        activeNode = root;
+        activeEdge = limit<u64>::max();
+        activeLength = 0;
+        remainingSuffixCount = 0;
+        convertTimer.reset();
+
+        {
+            PhaseTimer timer(counters, "suffix links");
+            linkSuffixes(threads);
+        }
+        PhaseTimer timer(counters, "leaf index");
+        indexLeaves();
+    }
+
+    // Sets the suffix link of every internal node top-down: the link of a node
+    // lies below the link of its parent, one character shallower, and is reached
+    // from there by edge lengths alone. The subtrees of the root are independent.
+    void SuffixTree::linkSuffixes(u32 threads) {
+        std::vector<NodeIndex> subtrees;
+        forEachChild(root, [&](char, NodeIndex child) {
+            if (!nodes[child].isLeaf()) {
+                subtrees.push_back(child);
+            }
+        });
+
+        parallelFor(subtrees.size(), threads, [&](u64 i) {
+            NodeIndex top = subtrees[i];
+            u64 topDepth = edgeLength(nodes[top]);
+            nodes[top].setSuffixLink(walkDown(root, 0, nodes[top].getStart() + 1, topDepth - 1));
+
+            std::vector<DepthFrame> stack = {{top, topDepth}};
+            while (!stack.empty()) {
+                DepthFrame frame = stack.back();
+                stack.pop_back();
+                NodeIndex parentLink = nodes[frame.node].getSuffixLink();
+                forEachChild(frame.node, [&](char, NodeIndex child) {
+                    if (nodes[child].isLeaf()) {
+                        return;
+                    }
+                    u64 depth = frame.depth + edgeLength(nodes[child]);
+                    u64 suffix = nodes[child].getStart() - frame.depth;
+                    nodes[child].setSuffixLink(walkDown(parentLink, frame.depth - 1, suffix + 1, depth - 1));
+                    stack.push_back({child, depth});
+                });
+            }
+        });
+    }
+
+    // Follows text[suffix ..] down from a node at the given depth until the
+    // target depth, which must end on a node
+    SuffixTree::NodeIndex SuffixTree::walkDown(NodeIndex node, u64 depth, u64 suffix, u64 targetDepth) const {
+        while (depth < targetDepth) {
+            node = findChild(node, text[suffix + depth]);
+            depth += edgeLength(nodes[node]);
+        }
+        return node;
+    }
+
+    SuffixTree::NodeIndex SuffixTree::newNode(u64 start, u64 end) {
+        nodes.emplace_back(start, end);
+        return static_cast<NodeIndex>(nodes.size() - 1);
+    }
+
+    u64 SuffixTree::edgeLength(const SuffixNode& node) const {
+        return node.getEnd(leafEnd) - node.getStart() + 1;
+    }
+
+    SuffixTree::NodeIndex SuffixTree::findChild(NodeIndex node, char key) const {
+        if (nodes[node].isLeaf()) {
+            return SuffixNode::NoNode;
+        }
+        return tables[nodes[node].getChildTable()].find(key);
+    }
+
+    void SuffixTree::setChild(NodeIndex node, char key, NodeIndex child) {
+        // A node gets its child table when its first child is attached
+        if (nodes[node].isLeaf()) {
+            tables.emplace_back();
+            nodes[node].childTable = static_cast<SuffixNode::TableIndex>(tables.size() - 1);
+        }
+        tables[nodes[node].getChildTable()].set(key, child);
+    }
+
+    u64 SuffixTree::memoryUsage() const {
+        if (frozen) {
+            return frozen->memoryUsage();
+        }
+        u64 bytes = text.ownedBytes() 
+            + nodes.size() * sizeof(SuffixNode) 
+            + tables.size() * sizeof(ChildTable)
+            + leafCounts.size() * sizeof(u32)
+            + leafOrder.size() * sizeof(u32)
+            + leafRanks.size() * sizeof(u32);
+        for (const auto& table : tables) {
+            bytes += table.heapBytes();
+        }
+        return bytes;
     }
 
     void SuffixTree::extendTree(u64 pos) {
         // Set the end for leaf nodes
-        *leafEnd = pos;
+        leafEnd = pos;
 
         // Number of suffixes to be added
         remainingSuffixCount++;
 
-        SuffixNodePtr lastNewNode = nullptr;
+        NodeIndex lastNewNode = SuffixNode::NoNode;
 
         // Iterate while there are still suffixes to add
         while (remainingSuffixCount > 0) {
@@ -48,59 +403,72 @@ namespace lab {
                 activeEdge = pos;
             }
 
-            char currentChar = (*text)[pos];
-            char activeChar = (*text)[activeEdge];
+            char currentChar = text[pos];
+            char activeChar = text[activeEdge];
 
             // Check if the current character exists in the active node's children
-            if (activeNode->getChildren().find(activeChar) == activeNode->getChildren().end()) {
-                // No such edge exists, create a new leaf node
-                activeNode->getChildren()[activeChar] = std::make_shared<SuffixNode>(pos, leafEnd);
+            NodeIndex nextNode = findChild(activeNode, activeChar);
+            if (nextNode == SuffixNode::NoNode) {
+                // No such edge exists, create a new leaf node. Leaves keep their
+                // suffix for good, so it is set here instead of by a final DFS.
+                NodeIndex leaf = newNode(pos, SuffixNode::OpenEnd);
+                nodes[leaf].setSuffixIndex(pos + 1 - remainingSuffixCount);
+                setChild(activeNode, activeChar, leaf);
+                if constexpr (StatsEnabled) {
+                    ++counters.extensions;
+                }
 
                 // Link the last created internal node to this one if necessary
-                if (lastNewNode != nullptr) {
-                    lastNewNode->setSuffixLink(activeNode);
-                    lastNewNode = activeNode->getChildren()[activeChar];
+                if (lastNewNode != SuffixNode::NoNode) {
+                    nodes[lastNewNode].setSuffixLink(activeNode);
+                    lastNewNode = leaf;
                 }
             } else {
-                // There is an edge, find the next node
-                SuffixNodePtr nextNode = activeNode->getChildren()[activeChar];
-
                 // Check if we are in the middle of an edge
-                u64 edgeLength = nextNode->getEnd() - nextNode->getStart() + 1;
-                if (activeLength >= edgeLength) {
+                u64 length = edgeLength(nodes[nextNode]);
+                if (activeLength >= length) {
                     // Move to the next node
-                    activeEdge += edgeLength;
-                    activeLength -= edgeLength;
+                    if constexpr (StatsEnabled) {
+                        ++counters.activePointHops;
+                    }
+                    activeEdge += length;
+                    activeLength -= length;
                     activeNode = nextNode;
                     continue;
                 }
 
                 // The character is already in the edge, rule 3 (extension ends)
-                if ((*text)[nextNode->getStart() + activeLength] == currentChar) {
+                if (text[nodes[nextNode].getStart() + activeLength] == currentChar) {
                     // We increment the active length and break
                     activeLength++;
-                    if (lastNewNode != nullptr) {
-                        lastNewNode->setSuffixLink(activeNode);
-                        lastNewNode = nullptr;
+                    if (lastNewNode != SuffixNode::NoNode) {
+                        nodes[lastNewNode].setSuffixLink(activeNode);
+                        lastNewNode = SuffixNode::NoNode;
                     }
                     break;
                 }
 
                 // Split the edge, create a new internal node
-                splitEnd = std::make_shared<u64>(nextNode->getStart() + activeLength - 1);
-                SuffixNodePtr splitNode = std::make_shared<SuffixNode>(nextNode->getStart(), splitEnd);
-                activeNode->getChildren()[activeChar] = splitNode;
+                if constexpr (StatsEnabled) {
+                    ++counters.splits;
+                    ++counters.extensions;
+                }
+                u64 nextStart = nodes[nextNode].getStart();
+                NodeIndex splitNode = newNode(nextStart, nextStart + activeLength - 1);
+                setChild(activeNode, activeChar, splitNode);
 
                 // Create a new leaf node
-                splitNode->getChildren()[currentChar] = std::make_shared<SuffixNode>(pos, leafEnd);
+                NodeIndex leaf = newNode(pos, SuffixNode::OpenEnd);
+                nodes[leaf].setSuffixIndex(pos + 1 - remainingSuffixCount);
+                setChild(splitNode, currentChar, leaf);
 
                 // Adjust the next node's start position
-                nextNode->start += activeLength;
-                splitNode->getChildren()[(*text)[nextNode->start]] = nextNode;
+                nodes[nextNode].start += activeLength;
+                setChild(splitNode, text[nodes[nextNode].start], nextNode);
 
                 // Link last internal node to the new split node
-                if (lastNewNode != nullptr) {
-                    lastNewNode->setSuffixLink(splitNode);
+                if (lastNewNode != SuffixNode::NoNode) {
+                    nodes[lastNewNode].setSuffixLink(splitNode);
                 }
                 lastNewNode = splitNode;
             }
@@ -113,56 +481,161 @@ namespace lab {
                 activeLength--;
                 activeEdge = pos - remainingSuffixCount + 1;
             } else if (activeNode != root) {
-                activeNode = activeNode->getSuffixLink() ? activeNode->getSuffixLink() : root;
+                NodeIndex link = nodes[activeNode].getSuffixLink();
+                activeNode = link != SuffixNode::NoNode ? link : root;
+                if constexpr (StatsEnabled) {
+                    ++counters.suffixLinkTraversals;
+                }
             }
         }
     }
 
-    // Depth-First Search to assign suffix indices to each leaf node
-    void SuffixTree::setSuffixIndexByDFS(SuffixNode::SuffixNodePtr node, u64 labelHeight) {
-        if (!node) return;
+    TreeStats SuffixTree::stats() const {
+        if (frozen) {
+            TreeStats result = counters;
+            result.bytes = memoryUsage();
+            return result;
+        }
+        TreeStats result = counters;
+        result.nodes = nodes.size();
+        result.bytes = memoryUsage();
 
-        // If it's a leaf, assign the suffix index
-        if (node->getChildren().empty()) {
-            u64 suffixIndex = size - labelHeight;
-            node->setSuffixIndex(suffixIndex); // Correctly setting the suffix index
+        std::vector<DepthFrame> stack = {{root, 0}};
+        while (!stack.empty()) {
+            DepthFrame frame = stack.back();
+            stack.pop_back();
+            result.maxDepth = std::max(result.maxDepth, frame.depth);
+            if (nodes[frame.node].isLeaf()) {
+                if (nodes[frame.node].suffixIndex != SuffixNode::NoSuffix) {
+                    ++result.leaves;
+                }
+                continue;
+            }
+            forEachChild(frame.node, [&](char, NodeIndex child) {
+                stack.push_back({child, frame.depth + 1});
+            });
+        }
+        return result;
+    }
+
+    void SuffixTree::save(const std::string& path) const {
+        if (frozen) {
+            frozen->save(path);
             return;
         }
+        FlatSuffixTree(*this).save(path);
+    }
+
+    // Lays the leaves out in DFS order, so that the leaves below any internal
+    // node form a contiguous run of leafOrder, and records where each run
+    // starts and how long it is.
+    void SuffixTree::indexLeaves() {
+        leafOrder.clear();
+        leafOrder.reserve(size);
+        leafRanks.assign(tables.size(), 0);
+        leafCounts.assign(tables.size(), 0);
 
-        // Traverse all children
-        for (auto& [key, child] : node->getChildren()) {
-            setSuffixIndexByDFS(child, labelHeight + (child->getEnd() - child->getStart() + 1));
+        std::vector<VisitFrame> stack;
+        stack.push_back({root, false});
+        while (!stack.empty()) {
+            VisitFrame frame = stack.back();
+            stack.pop_back();
+            if (nodes[frame.node].isLeaf()) {
+                // The root of an empty tree is the only leaf without a suffix
+                if (nodes[frame.node].suffixIndex != SuffixNode::NoSuffix) {
+                    leafOrder.push_back(nodes[frame.node].suffixIndex);
+                }
+                continue;
+            }
+
+            auto table = nodes[frame.node].getChildTable();
+            if (frame.leaving) {
+                leafCounts[table] = static_cast<u32>(leafOrder.size()) - leafRanks[table];
+                continue;
+            }
+            leafRanks[table] = static_cast<u32>(leafOrder.size());
+            stack.push_back({frame.node, true});
+
+            // Children are pushed in reverse so that they are visited in ascending order
+            u64 firstChild = stack.size();
+            forEachChild(frame.node, [&](char, NodeIndex child) {
+                stack.push_back({child, false});
+            });
+            std::reverse(stack.begin() + static_cast<i64>(firstChild), stack.end());
         }
+        indexedSize = size;
     }
 
-    // Searches for a pattern in the suffix tree
-    std::set<u64> SuffixTree::searchPattern(const std::string& pattern) {
-        if (pattern == "") {
-            return {};
+    // The leaf ranges cover every occurrence once they are up to date with the
+    // text and every suffix has become a leaf
+    bool SuffixTree::leafRangesValid() const {
+        return indexedSize == size && remainingSuffixCount == 0;
+    }
+
+    // Visits the suffix index of every occurrence of the pattern, whose locus is
+    // given, without the leaf ranges: the leaves below the locus, then the
+    // suffixes still implicit in the tree, which are the last remainingSuffixCount.
+    // The walk reuses a per-thread stack, concurrent queries share nothing.
+    template <class Visitor>
+    void SuffixTree::forEachOccurrence(NodeIndex locus, std::string_view pattern, Visitor&& visit) const {
+        if (locus != SuffixNode::NoNode) {
+            thread_local std::vector<NodeIndex> stack;
+            stack.assign(1, locus);
+            while (!stack.empty()) {
+                NodeIndex node = stack.back();
+                stack.pop_back();
+                if (nodes[node].isLeaf()) {
+                    if (nodes[node].suffixIndex != SuffixNode::NoSuffix) {
+                        visit(nodes[node].suffixIndex);
+                    }
+                    continue;
+                }
+                forEachChild(node, [&](char, NodeIndex child) {
+                    stack.push_back(child);
+                });
+            }
         }
-        SuffixNodePtr currentNode = root; // Start from the root node
-        u64 patternIndex = 0;             // Track the current index of the pattern
+        for (u64 suffix = size - remainingSuffixCount; suffix + pattern.size() <= size; ++suffix) {
+            u64 matched = 0;
+            while (matched < pattern.size() && text[suffix + matched] == pattern[matched]) {
+                ++matched;
+            }
+            if (matched == pattern.size()) {
+                visit(static_cast<u32>(suffix));
+            }
+        }
+    }
+
+    u64 SuffixTree::leafCount(NodeIndex node) const {
+        return nodes[node].isLeaf() ? 1 : leafCounts[nodes[node].getChildTable()];
+    }
+
+    // Walks the pattern down from the root. Returns the highest node whose path
+    // label starts with the pattern, or NoNode when the pattern does not occur.
+    SuffixTree::NodeIndex SuffixTree::findLocus(std::string_view pattern) const {
+        NodeIndex currentNode = root; // Start from the root node
+        u64 patternIndex = 0;         // Track the current index of the pattern
 
         // Traverse while there are characters left in the pattern
         while (patternIndex < pattern.size()) { 
             char currentChar = pattern[patternIndex];
 
             // Check if the current character exists in the current node's children
-            if (currentNode->getChildren().find(currentChar) == currentNode->getChildren().end()) {
+            NodeIndex nextNode = findChild(currentNode, currentChar);
+            if (nextNode == SuffixNode::NoNode) {
                 // The current character is not found among the children, pattern does not exist
-                return {};
+                return SuffixNode::NoNode;
             }
 
             // Move to the next node
-            SuffixNodePtr nextNode = currentNode->getChildren()[currentChar];
-            u64 edgeStart = nextNode->getStart();
-            u64 edgeEnd = nextNode->getEnd();
+            u64 edgeStart = nodes[nextNode].getStart();
+            u64 edgeEnd = nodes[nextNode].getEnd(leafEnd);
 
             // Compare the pattern characters with the edge characters
             for (u64 i = 0; i <= (edgeEnd - edgeStart) && patternIndex < pattern.size(); ++i) {
                 // If characters don't match, pattern is not found
-                if ((*text)[edgeStart + i] != pattern[patternIndex]) {
-                    return {};
+                if (text[edgeStart + i] != pattern[patternIndex]) {
+                    return SuffixNode::NoNode;
                 }
                 patternIndex++; // Move to the next character in the pattern
             }
@@ -170,24 +643,180 @@ namespace lab {
             // Move to the next node in the tree
             currentNode = nextNode;
         }
+        return currentNode;
+    }
+
+    // Loci of a batch of patterns, as findLocus would return them. The path of
+    // the previous walk is kept as a stack of the nodes it entered; a pattern
+    // sharing a prefix with the previous one resumes at the end of that prefix,
+    // possibly inside an edge, and one extending a prefix that failed fails too.
+    std::vector<SuffixTree::NodeIndex> SuffixTree::findLoci(std::span<const std::string> patterns) const {
+        std::vector<u64> order(patterns.size());
+        for (u64 i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        if (!std::is_sorted(patterns.begin(), patterns.end())) {
+            std::sort(order.begin(), order.end(), [&](u64 a, u64 b) {
+                return patterns[a] < patterns[b];
+            });
+        }
+
+        std::vector<NodeIndex> loci(patterns.size(), SuffixNode::NoNode);
+        std::vector<DepthFrame> path = {{root, 0}};
+        const std::string* previous = nullptr;
+        u64 reached = 0;     // Characters of the previous pattern found in the tree
+        bool failed = false; // Whether the previous pattern stopped at a mismatch
 
-        // If the entire pattern has been successfully traversed, it exists in the text
-        std::set<u64> indexes;
-        std::queue<SuffixNodePtr> order;
-        order.push(currentNode);
-        while (!order.empty()) {
-            auto& node = order.front();
-            order.pop();
-            if (node->getChildren().empty()) {
-                indexes.insert(node->suffixIndex);
+        for (u64 index : order) {
+            const std::string& pattern = patterns[index];
+            u64 common = 0;
+            if (previous != nullptr) {
+                u64 limit = std::min(previous->size(), pattern.size());
+                while (common < limit && (*previous)[common] == pattern[common]) {
+                    ++common;
+                }
+            }
+            if (failed && common > reached) {
+                continue;
             }
-            for (auto& [ch, child] : node->getChildren()) {
-                order.push(child);
+
+            // Back up to the edge that holds the end of the shared prefix
+            u64 matched = std::min(common, reached);
+            while (path.size() > 1 && path[path.size() - 2].depth >= matched) {
+                path.pop_back();
+            }
+            previous = &pattern;
+            failed = false;
+
+            while (matched < pattern.size()) {
+                DepthFrame top = path.back();
+                if (matched < top.depth) {
+                    // Inside the edge into the top node
+                    u64 edgeEnd = nodes[top.node].getEnd(leafEnd);
+                    if (text[edgeEnd + 1 - (top.depth - matched)] != pattern[matched]) {
+                        failed = true;
+                        break;
+                    }
+                    ++matched;
+                    continue;
+                }
+                NodeIndex next = findChild(top.node, pattern[matched]);
+                if (next == SuffixNode::NoNode) {
+                    failed = true;
+                    break;
+                }
+                path.push_back({next, top.depth + edgeLength(nodes[next])});
+            }
+            reached = matched;
+            if (!failed) {
+                loci[index] = path.back().node;
             }
         }
-        return indexes;
+        return loci;
     }
 
+    u64 SuffixTree::countPattern(std::string_view pattern) const {
+        if (frozen) {
+            return frozen->countPattern(pattern);
+        }
+        if (pattern.empty()) {
+            return 0;
+        }
+        NodeIndex locus = findLocus(pattern);
+        if (!leafRangesValid()) {
+            u64 count = 0;
+            forEachOccurrence(locus, pattern, [&](u32) { ++count; });
+            return count;
+        }
+        return locus == SuffixNode::NoNode ? 0 : leafCount(locus);
+    }
+
+    SuffixTree::Occurrences SuffixTree::findOccurrences(std::string_view pattern) const {
+        if (frozen) {
+            return frozen->findOccurrences(pattern);
+        }
+        if (pattern.empty()) {
+            return {};
+        }
+        NodeIndex locus = findLocus(pattern);
+        if (!leafRangesValid()) {
+            thread_local std::vector<u32> gathered;
+            gathered.clear();
+            forEachOccurrence(locus, pattern, [&](u32 suffix) { gathered.push_back(suffix); });
+            return gathered;
+        }
+        if (locus == SuffixNode::NoNode) {
+            return {};
+        }
+        // A leaf is its own single occurrence
+        if (nodes[locus].isLeaf()) {
+            return Occurrences(&nodes[locus].suffixIndex, 1);
+        }
+        auto table = nodes[locus].getChildTable();
+        return Occurrences(leafOrder).subspan(leafRanks[table], leafCounts[table]);
+    }
+
+    // Searches for a pattern in the suffix tree
+    std::set<u64> SuffixTree::searchPattern(const std::string& pattern) const {
+        // The matching leaves are a contiguous run of the DFS leaf order
+        Occurrences occurrences = findOccurrences(pattern);
+        return std::set<u64>(occurrences.begin(), occurrences.end());
+    }
+
+
+    std::vector<std::set<u64>> SuffixTree::searchPatterns(std::span<const std::string> patterns) const {
+        if (frozen) {
+            std::vector<std::set<u64>> results;
+            results.reserve(patterns.size());
+            for (const std::string& pattern : patterns) {
+                results.push_back(frozen->searchPattern(pattern));
+            }
+            return results;
+        }
+        std::vector<NodeIndex> loci = findLoci(patterns);
+        std::vector<std::set<u64>> results(patterns.size());
+        for (u64 i = 0; i < patterns.size(); ++i) {
+            if (patterns[i].empty()) {
+                continue;
+            }
+            if (!leafRangesValid()) {
+                forEachOccurrence(loci[i], patterns[i], [&](u32 suffix) { results[i].insert(suffix); });
+            } else if (loci[i] != SuffixNode::NoNode) {
+                if (nodes[loci[i]].isLeaf()) {
+                    results[i].insert(nodes[loci[i]].suffixIndex);
+                    continue;
+                }
+                auto table = nodes[loci[i]].getChildTable();
+                auto leaves = Occurrences(leafOrder).subspan(leafRanks[table], leafCounts[table]);
+                results[i].insert(leaves.begin(), leaves.end());
+            }
+        }
+        return results;
+    }
+
+    std::vector<u64> SuffixTree::countPatterns(std::span<const std::string> patterns) const {
+        if (frozen) {
+            std::vector<u64> counts;
+            counts.reserve(patterns.size());
+            for (const std::string& pattern : patterns) {
+                counts.push_back(frozen->countPattern(pattern));
+            }
+            return counts;
+        }
+        std::vector<NodeIndex> loci = findLoci(patterns);
+        std::vector<u64> counts(patterns.size(), 0);
+        for (u64 i = 0; i < patterns.size(); ++i) {
+            if (patterns[i].empty()) {
+                continue;
+            }
+            if (!leafRangesValid()) {
+                forEachOccurrence(loci[i], patterns[i], [&](u32) { ++counts[i]; });
+            } else if (loci[i] != SuffixNode::NoNode) {
+                counts[i] = leafCount(loci[i]);
+            }
+        }
+        return counts;
+    }
 
     std::pair<u64, std::set<std::string>> SuffixTree::findLCSString(const std::string& s1, const std::string& s2) {
         std::string combinedString = s1 + "#" + s2 + "$";
@@ -198,7 +827,7 @@ namespace lab {
 
         std::map<u64, u64> nodeCSLengths;
 
-        findLCSUtil(tree.root, 0, maxLength, splitPoint, nodeCSLengths);
+        tree.findLCSUtil(tree.root, 0, maxLength, splitPoint, nodeCSLengths);
 
         std::set<std::string> lcs;
         for (auto& [edge, length] : nodeCSLengths) {
@@ -224,7 +853,7 @@ namespace lab {
 
         std::map<u64, u64> nodeCSLengths;
 
-        findLCSUtil(tree.root, 0, maxLength, splitPoint, nodeCSLengths);
+        tree.findLCSUtil(tree.root, 0, maxLength, splitPoint, nodeCSLengths);
 
         std::vector<u64> indexes;
         for (auto& [end_index, length] : nodeCSLengths) {
@@ -240,70 +869,283 @@ namespace lab {
         return {maxLength, indexes};
     }
 
+    // Streams the query through the tree and visits (i, length of the longest
+    // prefix of query[i..] in the text) for every i. The match is kept as an
+    // explicit node, its string depth, and a total length that may end inside
+    // an edge below it. Dropping the first character follows the suffix link
+    // and the remainder is walked down again by edge lengths only, so the whole
+    // query costs O(|query|) amortised.
+    template <class Visitor>
+    void SuffixTree::forEachMatchingStatistic(std::string_view query, Visitor&& visit) const {
+        requireArena("matching statistics");
+        NodeIndex node = root;
+        u64 nodeDepth = 0;
+        u64 length = 0;
+        for (u64 i = 0; i < query.size(); ++i) {
+            while (true) {
+                // Skip whole internal edges, their characters are known to match
+                NodeIndex child = SuffixNode::NoNode;
+                u64 along = length - nodeDepth;
+                while (along > 0) {
+                    child = findChild(node, query[i + nodeDepth]);
+                    u64 edge = edgeLength(nodes[child]);
+                    if (along < edge || nodes[child].isLeaf()) {
+                        break;
+                    }
+                    node = child;
+                    nodeDepth += edge;
+                    along -= edge;
+                    child = SuffixNode::NoNode;
+                }
+                if (i + length == query.size()) {
+                    break;
+                }
+
+                // Extend the match by one character
+                char next = query[i + length];
+                if (along == 0) {
+                    if (findChild(node, next) == SuffixNode::NoNode) {
+                        break;
+                    }
+                } else if (along == edgeLength(nodes[child]) || text[nodes[child].getStart() + along] != next) {
+                    break;
+                }
+                ++length;
+            }
+            visit(i, length);
+
+            // Drop query[i]: a node without a link sends the walk back to the root
+            if (length == 0) {
+                continue;
+            }
+            --length;
+            if (node != root) {
+                NodeIndex link = nodes[node].getSuffixLink();
+                if (link == SuffixNode::NoNode) {
+                    node = root;
+                    nodeDepth = 0;
+                } else {
+                    node = link;
+                    --nodeDepth;
+                }
+            }
+        }
+    }
+
+    std::vector<u64> SuffixTree::matchingStatistics(std::string_view query) const {
+        std::vector<u64> statistics(query.size());
+        forEachMatchingStatistic(query, [&](u64 i, u64 length) {
+            statistics[i] = length;
+        });
+        return statistics;
+    }
+
+    std::pair<u64, std::vector<u64>> SuffixTree::findLCS(std::string_view query) const {
+        u64 maxLength = 0;
+        std::vector<u64> starts;
+        forEachMatchingStatistic(query, [&](u64 i, u64 length) {
+            if (length == 0 || length < maxLength) {
+                return;
+            }
+            if (length > maxLength) {
+                maxLength = length;
+                starts.clear();
+            }
+            starts.push_back(i);
+        });
+        return {maxLength, starts};
+    }
+
+    std::pair<u64, std::set<std::string>> SuffixTree::findLCSString(std::string_view query) const {
+        auto [maxLength, starts] = findLCS(query);
+        std::set<std::string> lcs;
+        for (u64 start : starts) {
+            lcs.emplace(query.substr(start, maxLength));
+        }
+        return {maxLength, lcs};
+    }
+
+    // Post-order walk that visits (parent depth, depth, summary) for every
+    // internal node but the root, i.e. every right-maximal repeat. Finished
+    // subtrees leave their summary on a value stack, and a node folds those of
+    // its children when it is left.
+    template <class Visitor>
+    void SuffixTree::forEachRepeat(Visitor&& visit) const {
+        requireArena("repeat queries");
+        if (!leafRangesValid()) {
+            throw std::logic_error("SuffixTree: repeats need a unique terminator and an indexed tree");
+        }
+
+        struct Frame {
+            NodeIndex node;
+            u64 parentDepth;
+            u64 summaries;  // Size of the value stack when the node was entered
+            bool leaving;
+        };
+        std::vector<Frame> stack = {{root, 0, 0, false}};
+        std::vector<RepeatSummary> summaries;
+        while (!stack.empty()) {
+            Frame frame = stack.back();
+            stack.pop_back();
+            const SuffixNode& node = nodes[frame.node];
+
+            if (node.isLeaf()) {
+                u64 suffix = node.getSuffixIndex();
+                if (suffix != limit<u64>::max()) {
+                    u16 left = suffix == 0 ? RepeatSummary::Diverse : static_cast<u8>(text[suffix - 1]);
+                    summaries.push_back({suffix, 1, left});
+                }
+                continue;
+            }
+
+            u64 depth = frame.node == root ? 0 : frame.parentDepth + edgeLength(node);
+            if (!frame.leaving) {
+                stack.push_back({frame.node, frame.parentDepth, summaries.size(), true});
+                forEachChild(frame.node, [&](char, NodeIndex child) {
+                    stack.push_back({child, depth, 0, false});
+                });
+                continue;
+            }
+
+            RepeatSummary summary = summaries[frame.summaries];
+            for (u64 i = frame.summaries + 1; i < summaries.size(); ++i) {
+                summary.first = std::min(summary.first, summaries[i].first);
+                summary.count += summaries[i].count;
+                if (summary.left != summaries[i].left) {
+                    summary.left = RepeatSummary::Diverse;
+                }
+            }
+            summaries.resize(frame.summaries);
+            summaries.push_back(summary);
+            if (frame.node != root) {
+                visit(frame.parentDepth, depth, summary);
+            }
+        }
+    }
+
+    std::vector<SuffixTree::Repeat> SuffixTree::maximalRepeats(u64 minLength) const {
+        std::vector<Repeat> repeats;
+        forEachRepeat([&](u64, u64 depth, const RepeatSummary& summary) {
+            if (summary.left == RepeatSummary::Diverse && depth >= std::max<u64>(minLength, 1)) {
+                repeats.push_back({summary.first, depth, summary.count});
+            }
+        });
+        std::sort(repeats.begin(), repeats.end(), [](const Repeat& a, const Repeat& b) {
+            return std::tie(a.start, a.length) < std::tie(b.start, b.length);
+        });
+        return repeats;
+    }
+
+    SuffixTree::Repeat SuffixTree::longestRepeat() const {
+        Repeat longest = {0, 0, 0};
+        forEachRepeat([&](u64, u64 depth, const RepeatSummary& summary) {
+            if (depth > longest.length || (depth == longest.length && summary.first < longest.start)) {
+                longest = {summary.first, depth, summary.count};
+            }
+        });
+        return longest;
+    }
+
+    // Keeps the best k candidates in a heap whose top is the worst of them
+    std::vector<SuffixTree::Repeat> SuffixTree::frequentSubstrings(u64 k, u64 minLength) const {
+        auto better = [](const Repeat& a, const Repeat& b) {
+            return std::tie(b.count, a.length, a.start) < std::tie(a.count, b.length, b.start);
+        };
+        std::vector<Repeat> best;
+        if (k == 0) {
+            return best;
+        }
+        forEachRepeat([&](u64 parentDepth, u64 depth, const RepeatSummary& summary) {
+            u64 length = std::max({minLength, parentDepth + 1, u64(1)});
+            if (length > depth) {
+                return;
+            }
+            Repeat candidate = {summary.first, length, summary.count};
+            if (best.size() < k) {
+                best.push_back(candidate);
+                std::push_heap(best.begin(), best.end(), better);
+            } else if (better(candidate, best.front())) {
+                std::pop_heap(best.begin(), best.end(), better);
+                best.back() = candidate;
+                std::push_heap(best.begin(), best.end(), better);
+            }
+        });
+        std::sort_heap(best.begin(), best.end(), better);
+        return best;
+    }
+
+    // Visits every node below node and records the internal nodes that have leaf
+    // children from both S1 and S2. Each node only looks at its direct children,
+    // so the visiting order is free and an explicit stack replaces recursion.
     void SuffixTree::findLCSUtil(
-        SuffixNodePtr node, 
+        NodeIndex node, 
         u64 depth, 
         u64& maxLength,
         u64 splitPoint,
         std::map<u64, u64>& nodeCSLengths
-    ) {
-        bool containsS1Suffix = false;
-        bool containsS2Suffix = false;
-
-        if (!node->getChildren().empty()) {
-            // Traverse children to gather information
-            for (auto& [key, child] : node->getChildren()) {
-                findLCSUtil(
-                    child, 
-                    depth + (child->getEnd() - child->getStart() + 1), 
-                    maxLength,
-                    splitPoint,
-                    nodeCSLengths
-                );
-                
-                // Gather S1/S2 suffix information from child nodes
-                auto index = child->getSuffixIndex();
+    ) const {
+        std::vector<DepthFrame> stack;
+        stack.push_back({node, depth});
+        while (!stack.empty()) {
+            DepthFrame frame = stack.back();
+            stack.pop_back();
+
+            bool containsS1Suffix = false;
+            bool containsS2Suffix = false;
+
+            // Gather S1/S2 suffix information from child leaves, queue internal children
+            forEachChild(frame.node, [&](char, NodeIndex child) {
+                if (!nodes[child].isLeaf()) {
+                    stack.push_back({child, frame.depth + edgeLength(nodes[child])});
+                    return;
+                }
+                auto index = nodes[child].getSuffixIndex();
                 if (index == limit<u64>::max()) {
-                    continue;
+                    return;
                 } else if (index < splitPoint) {
                     containsS1Suffix = true;
                 } else if (index >= splitPoint) {
                     containsS2Suffix = true;
                 }
-            }
-        }
+            });
 
-        // Update the LCS properties if this node contains both S1 and S2 suffixes
-        if (containsS1Suffix && containsS2Suffix && 
-            depth >= maxLength && node->start != limit<u64>::max()) {
-            maxLength = depth;
-            nodeCSLengths[node->getEnd()] = maxLength;
+            // Update the LCS properties if this node contains both S1 and S2 suffixes
+            if (containsS1Suffix && containsS2Suffix && 
+                frame.depth >= maxLength && nodes[frame.node].start != limit<u64>::max()) {
+                maxLength = frame.depth;
+                nodeCSLengths[nodes[frame.node].getEnd(leafEnd)] = maxLength;
+            }
         }
     }
 
 
 
     std::ostream& operator<<(std::ostream& os, const SuffixTree& tree) {
-        std::function<void(SuffixTree::SuffixNodePtr, u8)> printTree;
-        
-        auto text = tree.text;
+        tree.requireArena("printing");
+        const Text& text = tree.text;
 
-        printTree = [&](SuffixTree::SuffixNodePtr node, u8 depth) {
-            if (node == nullptr) return;
+        // Pre-order walk with an explicit stack, children are pushed in reverse
+        // so that they are printed in ascending order
+        std::vector<SuffixTree::DepthFrame> stack;
+        stack.push_back({tree.root, 0});
+        while (!stack.empty()) {
+            auto [index, depth] = stack.back();
+            stack.pop_back();
+            const SuffixNode& node = tree.nodes[index];
 
-            if (node->getStart() != limit<u64>::max()) {  // Skip root node
+            if (node.getStart() != limit<u64>::max()) {  // Skip root node
                 os << std::string(depth * 2, ' ') 
-                << text->substr(node->getStart(), node->getEnd() - node->getStart() + 1)
-                << (node->getChildren().empty() ? " [" + std::to_string(node->getSuffixIndex()) + "]" : "") 
+                << text.substr(node.getStart(), tree.edgeLength(node))
+                << (node.isLeaf() ? " [" + std::to_string(node.getSuffixIndex()) + "]" : "") 
                 << "\n";
             }
 
-            for (const auto &child : node->getChildren()) {
-                printTree(child.second, depth + 1);
-            }
-        };
-
-        printTree(tree.root, 0);
+            u64 firstChild = stack.size();
+            tree.forEachChild(index, [&](char, SuffixTree::NodeIndex child) {
+                stack.push_back({child, depth + 1});
+            });
+            std::reverse(stack.begin() + static_cast<i64>(firstChild), stack.end());
+        }
         return os;
     }
 
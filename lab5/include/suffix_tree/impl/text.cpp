@@ -0,0 +1,81 @@
+#include "../text.hpp"
+#include "../mapped_file.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace lab {
+
+    Text::Text()
+        :   Text(std::string_view(), nullptr, 0, std::nullopt) {}
+
+    Text::Text(std::string_view body, std::shared_ptr<const void> storage, 
+               u64 ownedSize, std::optional<char> terminator)
+        :   body(body),
+            storage(std::move(storage)),
+            ownedSize(ownedSize),
+            terminator(terminator.value_or('\0')),
+            terminated(terminator.has_value()) {}
+
+    Text Text::copy(std::string_view body, std::optional<char> terminator) {
+        auto owned = std::make_shared<std::string>(body);
+        std::string_view view(*owned);
+        Text text(view, owned, view.size(), terminator);
+        text.owned = owned.get();
+        return text;
+    }
+
+    Text Text::borrow(std::string_view body, std::optional<char> terminator) {
+        return Text(body, nullptr, 0, terminator);
+    }
+
+    Text Text::map(const std::string& path, std::optional<char> terminator) {
+        auto file = std::make_shared<const MappedFile>(path);
+        std::string_view view = file->getView();
+        return Text(view, std::move(file), 0, terminator);
+    }
+
+    void Text::append(std::string_view more) {
+        if (terminated || (owned == nullptr && !body.empty())) {
+            throw std::logic_error("Text: only copied text without a terminator can grow");
+        }
+        // Copies of a Text share their bytes, the first append detaches them
+        if (owned == nullptr || storage.use_count() > 1) {
+            auto detached = std::make_shared<std::string>(body);
+            owned = detached.get();
+            storage = std::move(detached);
+        }
+        owned->append(more);
+        body = *owned;
+        ownedSize = owned->size();
+    }
+
+    std::string Text::substr(u64 pos, u64 length) const {
+        std::string result;
+        if (pos >= size()) {
+            return result;
+        }
+        length = std::min(length, size() - pos);
+        result.reserve(length);
+        result.append(body.substr(pos, length));
+        if (terminated && pos + length > body.size()) {
+            result.push_back(terminator);
+        }
+        return result;
+    }
+
+    std::string_view Text::getBody() const {
+        return body;
+    }
+
+    std::optional<char> Text::getTerminator() const {
+        if (terminated) {
+            return terminator;
+        }
+        return std::nullopt;
+    }
+
+    u64 Text::ownedBytes() const {
+        return ownedSize;
+    }
+}
@@ -0,0 +1,23 @@
+#include "../tree_stats.hpp"
+
+namespace lab {
+
+    std::ostream& operator<<(std::ostream& os, const TreeStats& stats) {
+        os << "nodes: " << stats.nodes << "\n"
+           << "leaves: " << stats.leaves << "\n"
+           << "max depth: " << stats.maxDepth << "\n"
+           << "bytes: " << stats.bytes << "\n";
+        if constexpr (!StatsEnabled) {
+            os << "(build with -DLAB_STATS=ON for construction counters and phase times)\n";
+            return os;
+        }
+        os << "extensions: " << stats.extensions << "\n"
+           << "splits: " << stats.splits << "\n"
+           << "active point hops: " << stats.activePointHops << "\n"
+           << "suffix link traversals: " << stats.suffixLinkTraversals << "\n";
+        for (const auto& [phase, seconds] : stats.phases) {
+            os << "phase " << phase << ": " << seconds << " s\n";
+        }
+        return os;
+    }
+}
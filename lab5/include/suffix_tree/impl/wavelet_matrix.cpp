@@ -0,0 +1,112 @@
+#include "../wavelet_matrix.hpp"
+
+#include <stdexcept>
+
+namespace lab {
+
+    // One spare word, so that rank1(size()) never reads past the end
+    RankBitVector::RankBitVector(u64 size)
+        :   words(size / 64 + 1, 0),
+            length(size) {}
+
+    void RankBitVector::set(u64 pos) {
+        words[pos / 64] |= u64(1) << (pos % 64);
+    }
+
+    void RankBitVector::build() {
+        blockRanks.assign(words.size() / BlockWords + 1, 0);
+        u64 ones = 0;
+        for (u64 i = 0; i < words.size(); ++i) {
+            if (i % BlockWords == 0) {
+                blockRanks[i / BlockWords] = ones;
+            }
+            ones += static_cast<u64>(std::popcount(words[i]));
+        }
+    }
+
+    u64 RankBitVector::size() const {
+        return length;
+    }
+
+    u64 RankBitVector::memoryUsage() const {
+        return (words.capacity() + blockRanks.capacity()) * sizeof(u64);
+    }
+
+    WaveletMatrix::WaveletMatrix(std::span<const u8> symbols, u32 bits)
+        :   zeros(bits, 0),
+            length(symbols.size()),
+            bits(bits) {
+        if (bits == 0 || bits > 8) {
+            throw std::invalid_argument("WaveletMatrix: symbols take 1 to 8 bits");
+        }
+        std::vector<u8> current(symbols.begin(), symbols.end());
+        std::vector<u8> next(current.size());
+        levels.reserve(bits);
+        for (u32 level = 0; level < bits; ++level) {
+            u32 shift = bits - 1 - level;
+            RankBitVector vector(length);
+            for (u64 i = 0; i < length; ++i) {
+                if ((current[i] >> shift) & 1) {
+                    vector.set(i);
+                } else {
+                    ++zeros[level];
+                }
+            }
+            vector.build();
+            levels.push_back(std::move(vector));
+
+            // Stable partition, zeros first, for the level below
+            u64 zero = 0;
+            u64 one = zeros[level];
+            for (u64 i = 0; i < length; ++i) {
+                next[((current[i] >> shift) & 1) ? one++ : zero++] = current[i];
+            }
+            current.swap(next);
+        }
+    }
+
+    // Follows the range [0, pos) of the symbol down the levels; what is left of
+    // it at the bottom is its occurrences
+    u64 WaveletMatrix::rank(u8 symbol, u64 pos) const {
+        u64 begin = 0;
+        u64 end = pos;
+        for (u32 level = 0; level < bits; ++level) {
+            const RankBitVector& vector = levels[level];
+            if ((symbol >> (bits - 1 - level)) & 1) {
+                begin = zeros[level] + vector.rank1(begin);
+                end = zeros[level] + vector.rank1(end);
+            } else {
+                begin = vector.rank0(begin);
+                end = vector.rank0(end);
+            }
+        }
+        return end - begin;
+    }
+
+    u8 WaveletMatrix::access(u64 pos) const {
+        u8 symbol = 0;
+        for (u32 level = 0; level < bits; ++level) {
+            const RankBitVector& vector = levels[level];
+            if (vector[pos]) {
+                symbol = static_cast<u8>(symbol << 1 | 1);
+                pos = zeros[level] + vector.rank1(pos);
+            } else {
+                symbol = static_cast<u8>(symbol << 1);
+                pos = vector.rank0(pos);
+            }
+        }
+        return symbol;
+    }
+
+    u64 WaveletMatrix::size() const {
+        return length;
+    }
+
+    u64 WaveletMatrix::memoryUsage() const {
+        u64 bytes = zeros.capacity() * sizeof(u64);
+        for (const auto& level : levels) {
+            bytes += level.memoryUsage();
+        }
+        return bytes;
+    }
+}
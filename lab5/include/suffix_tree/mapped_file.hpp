@@ -0,0 +1,30 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include "../type_aliases.hpp"
+#include <string>
+#include <string_view>
+
+namespace lab {
+
+    // Read-only memory mapping of a whole file, unmapped on destruction
+    class MappedFile {
+    public:
+        // Constructors
+        explicit MappedFile(const std::string& path);
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        // File properties
+        const char* getData() const;
+        u64 getSize() const;
+        std::string_view getView() const;
+
+    private:
+        void* address;
+        u64 size;
+    };
+}
+
+#endif // MAPPED_FILE_HPP
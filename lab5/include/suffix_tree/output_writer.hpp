@@ -0,0 +1,49 @@
+#ifndef OUTPUT_WRITER_HPP
+#define OUTPUT_WRITER_HPP
+
+#include "../type_aliases.hpp"
+#include <string>
+#include <string_view>
+
+namespace lab {
+
+    // Longest decimal representation of a u64
+    inline constexpr u64 MaxDecimalDigits = 20;
+
+    // Writes the decimal digits of value to out, two at a time, and returns
+    // how many were written (at most MaxDecimalDigits)
+    u64 formatDecimal(u64 value, char* out);
+    // Appends the decimal digits of value, same output as std::to_string
+    void appendDecimal(std::string& out, u64 value);
+
+    // Output buffered in one reusable block and handed to the file descriptor
+    // with a single write per flush (retried only on partial writes). Nothing
+    // is written on destruction: flush() reports errors as std::system_error.
+    class OutputWriter {
+    public:
+        static constexpr u64 DefaultCapacity = u64(1) << 20;
+
+        // Constructors
+        explicit OutputWriter(int fd, u64 capacity = DefaultCapacity);
+        OutputWriter(const OutputWriter&) = delete;
+        OutputWriter& operator=(const OutputWriter&) = delete;
+
+        // Buffers the text, flushing first when it does not fit; text larger
+        // than the whole buffer is written through
+        void write(std::string_view text);
+        void writeDecimal(u64 value);
+        void flush();
+
+        // Bytes waiting for the next flush
+        u64 pending() const;
+
+    private:
+        void writeAll(const char* data, u64 size);
+
+        int fd;
+        u64 capacity;
+        std::string buffer;
+    };
+}
+
+#endif // OUTPUT_WRITER_HPP
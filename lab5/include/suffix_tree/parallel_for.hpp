@@ -0,0 +1,88 @@
+#ifndef PARALLEL_FOR_HPP
+#define PARALLEL_FOR_HPP
+
+#include "../type_aliases.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lab {
+
+    // First exception thrown by any of a group of threads. Workers capture
+    // what they catch, and the owner rethrows it once every worker is joined,
+    // so an exception never escapes a thread body into std::terminate.
+    class FirstError {
+    public:
+        // Keeps the error unless an earlier one was captured
+        void capture(std::exception_ptr error) {
+            std::lock_guard lock(mutex);
+            if (!first) {
+                first = std::move(error);
+                captured = true;
+            }
+        }
+
+        bool failed() const {
+            return captured;
+        }
+
+        void rethrow() const {
+            if (captured) {
+                std::rethrow_exception(first);
+            }
+        }
+
+    private:
+        std::mutex mutex;
+        std::exception_ptr first;
+        std::atomic<bool> captured = false;
+    };
+
+    // Calls body(i) for every i in [0, count) on up to threads threads. Indexes
+    // are handed out one at a time, so uneven pieces of work balance themselves.
+    // The first exception of any body stops the handing out and is rethrown on
+    // the calling thread after every worker has been joined.
+    template <class Body>
+    void parallelFor(u64 count, u32 threads, Body&& body) {
+        u64 workers = std::min<u64>(threads, count);
+        if (workers <= 1) {
+            for (u64 i = 0; i < count; ++i) {
+                body(i);
+            }
+            return;
+        }
+
+        std::atomic<u64> next = 0;
+        FirstError error;
+        auto work = [&]() {
+            try {
+                for (u64 i = next++; i < count; i = next++) {
+                    body(i);
+                }
+            } catch (...) {
+                error.capture(std::current_exception());
+                next = count;
+            }
+        };
+        std::vector<std::thread> pool;
+        try {
+            for (u64 i = 1; i < workers; ++i) {
+                pool.emplace_back(work);
+            }
+        } catch (...) {
+            // Could not start a thread: stop, the started ones are joined below
+            error.capture(std::current_exception());
+            next = count;
+        }
+        work();
+        for (auto& thread : pool) {
+            thread.join();
+        }
+        error.rethrow();
+    }
+}
+
+#endif // PARALLEL_FOR_HPP
@@ -0,0 +1,96 @@
+#ifndef QUERY_CACHE_HPP
+#define QUERY_CACHE_HPP
+
+#include "../type_aliases.hpp"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace lab {
+
+    // Bounded LRU cache of query results keyed by pattern, shared by any number
+    // of threads. Results are immutable and handed out by shared pointer, so an
+    // evicted entry stays valid for whoever still holds it. Every lookup names
+    // the version of the index it is about; a new version drops all entries.
+    class QueryCache {
+    public:
+        // Sorted occurrence positions of a pattern
+        using Positions = std::shared_ptr<const std::vector<u64>>;
+
+        struct Stats {
+            u64 hits = 0;
+            u64 misses = 0;
+            u64 evictions = 0;
+            u64 invalidations = 0;  // Times a new index version dropped the entries
+            u64 entries = 0;
+            u64 bytes = 0;
+        };
+
+        // Bookkeeping charged to every entry on top of its pattern and positions
+        static constexpr u64 EntryOverhead = 128;
+
+        // Constructors
+        explicit QueryCache(u64 byteBudget);
+        QueryCache(const QueryCache&) = delete;
+        QueryCache& operator=(const QueryCache&) = delete;
+
+        // Cached positions of the pattern, or those of search() stored for the
+        // next lookup. search runs without the lock held; results larger than
+        // the whole budget are returned but not kept.
+        template <class Search>
+        Positions get(const std::string& pattern, u64 version, Search&& search);
+
+        void clear();
+        Stats stats() const;
+        u64 getByteBudget() const;
+
+    private:
+        struct Entry {
+            std::string pattern;
+            Positions positions;
+            u64 bytes;
+        };
+
+        // Under the lock: the entry moved to the front, or null
+        Positions find(const std::string& pattern, u64 version);
+        void insert(const std::string& pattern, u64 version, Positions positions);
+        void dropAll();
+
+        mutable std::mutex mutex;
+        std::list<Entry> entries;  // Most recently used first
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;  // Keys view into entries
+        u64 byteBudget;
+        u64 version = 0;
+        Stats counters;
+    };
+
+    std::ostream& operator<<(std::ostream& os, const QueryCache::Stats& stats);
+
+    template <class Search>
+    QueryCache::Positions QueryCache::get(const std::string& pattern, u64 version, Search&& search) {
+        if (Positions cached = find(pattern, version)) {
+            return cached;
+        }
+        Positions positions = std::make_shared<const std::vector<u64>>(search());
+        insert(pattern, version, positions);
+        return positions;
+    }
+
+    // Version of an index for the cache: indexes that can change report theirs,
+    // the others never change
+    template <class Index>
+    u64 indexVersion(const Index& index) {
+        if constexpr (requires { index.getVersion(); }) {
+            return index.getVersion();
+        } else {
+            return 0;
+        }
+    }
+}
+
+#endif // QUERY_CACHE_HPP
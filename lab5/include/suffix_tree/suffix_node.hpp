@@ -2,30 +2,39 @@
 #define SUFFIX_NODE_HPP
 
 #include "../type_aliases.hpp"
-#include <map>
-#include <memory>
 
 namespace lab {
 
     // Forward declaration of SuffixTree
     class SuffixTree;
 
-    // SuffixNode class representing a node in the suffix tree
+    // SuffixNode class representing a node in the suffix tree.
+    // Nodes live in an arena owned by the tree and refer to each other by index.
     class SuffixNode {
     public:
-        using SuffixNodePtr = std::shared_ptr<SuffixNode>;
-        using ChildrenMap = std::map<char, SuffixNodePtr>;
+        using NodeIndex = u32;
+        using TableIndex = u32;
+
+        // Index value meaning "no node"
+        static constexpr NodeIndex NoNode = limit<NodeIndex>::max();
+        // Table index of nodes without children
+        static constexpr TableIndex NoTable = limit<TableIndex>::max();
+        // Stored suffix index of nodes that are not leaves
+        static constexpr u32 NoSuffix = limit<u32>::max();
+        // End value of leaf edges, resolved through the tree's leafEnd
+        static constexpr u64 OpenEnd = limit<u64>::max();
 
         // Constructors
         SuffixNode();
-        SuffixNode(u64 start, U64Ptr end);
+        SuffixNode(u64 start, u64 end);
 
         // Node properties
         u64 getStart() const;
-        u64 getEnd() const;
-        ChildrenMap& getChildren();
-        SuffixNodePtr getSuffixLink();
-        void setSuffixLink(SuffixNodePtr node);
+        u64 getEnd(u64 leafEnd) const;
+        TableIndex getChildTable() const;
+        bool isLeaf() const;
+        NodeIndex getSuffixLink() const;
+        void setSuffixLink(NodeIndex node);
 
         // Suffix Index
         void setSuffixIndex(u64 index);
@@ -33,10 +42,10 @@ namespace lab {
 
     private:
         u64 start;
-        U64Ptr end;
-        ChildrenMap children;
-        SuffixNodePtr suffixLink; // Link to another node in the tree
-        u64 suffixIndex;          // Suffix index for leaf nodes (default: -1 if not a leaf)
+        u64 end;                  // Inclusive end of the edge label, OpenEnd for leaves
+        NodeIndex suffixLink;     // Link to another node in the tree
+        TableIndex childTable;    // Children in the tree's table pool, NoTable for leaves
+        u32 suffixIndex;          // Suffix index for leaf nodes (default: NoSuffix if not a leaf)
 
         friend SuffixTree;
     };
@@ -2,56 +2,214 @@
 #define SUFFIX_TREE_HPP
 
 #include "suffix_node.hpp"
+#include "child_table.hpp"
+#include "text.hpp"
+#include "tree_stats.hpp"
 #include "../type_aliases.hpp"
 #include <string>
 #include <vector>
 #include <set>
+#include <map>
+#include <memory>
+#include <span>
+#include <string_view>
 
 namespace lab {
 
+    class FlatSuffixTree;
+
+    // Thread safety: the const members never modify the tree, so any number of
+    // threads may query one tree at once without locking, as long as none of
+    // them builds, appends, reindexes or freezes it meanwhile. findOccurrences
+    // and countPattern do not allocate on an indexed tree (a unique terminator,
+    // and reindex() after appends); otherwise they reuse per-thread buffers.
     class SuffixTree {
     public:
-        using StringPtr = std::shared_ptr<std::string>;
-        using SuffixNodePtr = SuffixNode::SuffixNodePtr;
+        using NodeIndex = SuffixNode::NodeIndex;
+        // Suffix indexes of matching leaves in tree (DFS) order, a view into the tree
+        // (or into a per-thread buffer, see findOccurrences)
+        using Occurrences = std::span<const u32>;
 
         // Constructors
         SuffixTree(const std::string& text);
+        // Indexes text in place: borrowed and mapped bytes are not copied
+        explicit SuffixTree(Text text);
+        // Builds the same tree with several threads, from the suffix and LCP
+        // arrays, when the last character is unique (sequentially otherwise)
+        SuffixTree(Text text, u32 threads);
 
         // Public interface
         void buildTree(const std::string& text);
-        std::set<u64> searchPattern(const std::string& pattern);
+        // Extends the tree online, queries stay valid between appends. Only a
+        // copied text without a terminator can grow (std::logic_error otherwise).
+        void append(char c);
+        void append(std::string_view more);
+        // Re-lays the leaf ranges after appends: counting is O(|pattern|) again
+        // and occurrences are views into the tree
+        void reindex();
+        // Rewrites the finished tree into the read-only FlatSuffixTree layout,
+        // children contiguous in BFS order, and releases the node arena and the
+        // text. Pattern queries and save() then go through the flat layout, and
+        // stats() reports the shape and counters measured when it froze; the
+        // mutators and the queries that need suffix links or the arena (matching
+        // statistics, LCS against the text, repeats, printing) throw
+        // std::logic_error. Needs the leaf ranges, as FlatSuffixTree does.
+        void freeze();
+        bool isFrozen() const;
+        std::set<u64> searchPattern(const std::string& pattern) const;
+        // Number of occurrences in O(|pattern|), independent of how many there are
+        u64 countPattern(std::string_view pattern) const;
+        // Occurrences without allocating or sorting, valid as long as the tree is.
+        // After an append and before reindex(), or while some suffixes of the text
+        // are not leaves (no unique terminator), they are gathered by walking the
+        // subtree into a per-thread buffer, valid until the next call on that thread.
+        Occurrences findOccurrences(std::string_view pattern) const;
+        // Batch queries, answers in the order of the patterns. The patterns are
+        // walked in sorted order and each walk resumes from the deepest node of
+        // the previous one that their common prefix covers, so shared prefixes
+        // are matched once.
+        std::vector<std::set<u64>> searchPatterns(std::span<const std::string> patterns) const;
+        std::vector<u64> countPatterns(std::span<const std::string> patterns) const;
         static std::pair<u64, std::vector<u64>> findLCS(const std::string& s1, const std::string& s2);
         static std::pair<u64, std::set<std::string>> findLCSString(const std::string& s1, const std::string& s2);
 
+        // Queries against the indexed text in O(|query|) through suffix links,
+        // without building anything. Entry i of the matching statistics is the
+        // length of the longest prefix of query[i..] that occurs in the text.
+        std::vector<u64> matchingStatistics(std::string_view query) const;
+        // Longest common substrings of the text and the query: their length and
+        // their start positions in the query, or the distinct strings
+        std::pair<u64, std::vector<u64>> findLCS(std::string_view query) const;
+        std::pair<u64, std::set<std::string>> findLCSString(std::string_view query) const;
+
+        // A repeated substring: its first occurrence, length and occurrence count
+        struct Repeat {
+            u64 start;
+            u64 length;
+            u64 count;
+
+            bool operator==(const Repeat&) const = default;
+        };
+        // Repeat analytics, each computed in one bottom-up pass over the tree.
+        // They need every suffix to be a leaf: a unique terminator, and reindex()
+        // after appends (std::logic_error otherwise).
+        // Repeats that lose an occurrence when extended left or right, of at
+        // least minLength, by first occurrence then length
+        std::vector<Repeat> maximalRepeats(u64 minLength = 1) const;
+        // Longest substring occurring at least twice, the earliest on ties;
+        // length 0 when no character repeats
+        Repeat longestRepeat() const;
+        // The k most frequent substrings of at least minLength that occur at least
+        // twice, by count, then length, then first occurrence. Substrings that end
+        // on the same edge occur at the same places, only the shortest is reported.
+        std::vector<Repeat> frequentSubstrings(u64 k, u64 minLength) const;
+
+        // Bytes held by the text, node arena, child tables and leaf ranges
+        u64 memoryUsage() const;
+
+        // Changes whenever the text does (buildTree, append), so that cached
+        // query results can tell they are stale
+        u64 getVersion() const;
+
+        // Shape of the tree, plus construction counters and phase times when
+        // compiled with LAB_STATS. The shape is measured by a walk on each call.
+        TreeStats stats() const;
+
+        // Writes the flattened tree to a file that FlatSuffixTree::load maps
+        void save(const std::string& path) const;
+
     private:
+        // Ukkonen construction over the current text
+        void build();
+        // Parallel construction from the suffix and LCP arrays
+        void buildFromSuffixArray(u32 threads);
+        void linkSuffixes(u32 threads);
+        NodeIndex walkDown(NodeIndex node, u64 depth, u64 suffix, u64 targetDepth) const;
+
+        // Node arena helpers
+        NodeIndex newNode(u64 start, u64 end);
+        u64 edgeLength(const SuffixNode& node) const;
+        NodeIndex findChild(NodeIndex node, char key) const;
+        void setChild(NodeIndex node, char key, NodeIndex child);
+        template <class Visitor>
+        void forEachChild(NodeIndex node, Visitor&& visit) const;
+
+        // Explicit traversal stack entry: a node and the string depth at its end
+        struct DepthFrame {
+            NodeIndex node;
+            u64 depth;
+        };
+
+        // Explicit traversal stack entry for walks that also act after a subtree
+        struct VisitFrame {
+            NodeIndex node;
+            bool leaving;
+        };
+
+        // Summary of a finished subtree for the repeat queries
+        struct RepeatSummary {
+            u64 first;      // Smallest suffix index below
+            u64 count;      // Leaves below
+            u16 left;       // Character before every suffix below, or Diverse
+            static constexpr u16 Diverse = 256;
+        };
+
         // Internal helper functions
         void extendTree(u64 pos);
-        void setSuffixIndexByDFS(SuffixNodePtr node, u64 labelHeight);
-        static void findLCSUtil(
-            SuffixNodePtr node, 
+        void indexLeaves();
+        bool leafRangesValid() const;
+        template <class Visitor>
+        void forEachOccurrence(NodeIndex locus, std::string_view pattern, Visitor&& visit) const;
+        template <class Visitor>
+        void forEachMatchingStatistic(std::string_view query, Visitor&& visit) const;
+        template <class Visitor>
+        void forEachRepeat(Visitor&& visit) const;
+        NodeIndex findLocus(std::string_view pattern) const;
+        // Throws std::logic_error naming the operation once the tree is frozen
+        void requireArena(const char* operation) const;
+        std::vector<NodeIndex> findLoci(std::span<const std::string> patterns) const;
+        u64 leafCount(NodeIndex node) const;
+        void findLCSUtil(
+            NodeIndex node, 
             u64 depth, 
             u64& maxLength,
             u64 splitPoint,
             std::map<u64, u64>& nodeCSLengths
-        );
+        ) const;
 
         // Tree properties
-        StringPtr text;                        // The input string
-        SuffixNodePtr root;        // Root of the suffix tree
-        SuffixNodePtr activeNode;  // Active node for construction
+        Text text;                      // The input string
+        std::vector<SuffixNode> nodes;  // Node arena, addressed by NodeIndex
+        std::vector<ChildTable> tables; // Child tables of internal nodes
+        std::vector<u32> leafCounts;    // Leaves below each internal node, by child table
+        std::vector<u32> leafOrder;     // Suffix indexes of all leaves in DFS order
+        std::vector<u32> leafRanks;     // Position of each internal node's first leaf in leafOrder, by child table
+        NodeIndex root;                 // Root of the suffix tree
+        NodeIndex activeNode;           // Active node for construction
         u64 activeEdge;
         u64 activeLength;
         u64 remainingSuffixCount;
-        U64Ptr leafEnd;
-        U64Ptr rootEnd;
-        U64Ptr splitEnd;
+        u64 leafEnd;                    // Shared end of every leaf edge
         u64 size; // Size of the input string
+        u64 indexedSize;                // Size of the text when the leaf ranges were laid out
+        TreeStats counters;             // Construction events, kept with LAB_STATS only
+        u64 version = 0;                // Bumped whenever the text changes
+        std::shared_ptr<const FlatSuffixTree> frozen;  // Serves the queries once frozen
 
         friend std::ostream& operator<<(std::ostream& os, SuffixTree const& t);
+        friend class FlatSuffixTree;
+        friend class GeneralizedSuffixTree;
 
     };
 
     std::ostream& operator<<(std::ostream& os, SuffixTree const& t);
+
+    template <class Visitor>
+    void SuffixTree::forEachChild(NodeIndex node, Visitor&& visit) const {
+        if (!nodes[node].isLeaf()) {
+            tables[nodes[node].getChildTable()].forEach(visit);
+        }
+    }
 }
 
 #endif // SUFFIX_TREE_HPP
@@ -0,0 +1,59 @@
+#ifndef TEXT_HPP
+#define TEXT_HPP
+
+#include "../type_aliases.hpp"
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace lab {
+
+    // Text indexed by a suffix tree. The bytes are either copied, borrowed from
+    // caller-owned memory or memory-mapped from a file, and may be followed by a
+    // virtual terminator that is never stored.
+    class Text {
+    public:
+        // Constructors
+        Text();
+        static Text copy(std::string_view body, std::optional<char> terminator = std::nullopt);
+        static Text borrow(std::string_view body, std::optional<char> terminator = std::nullopt);
+        static Text map(const std::string& path, std::optional<char> terminator = std::nullopt);
+
+        // Grows a copied, unterminated text in place; throws std::logic_error otherwise
+        void append(std::string_view more);
+
+        // Character at pos, the terminator sits at getBody().size()
+        char operator[](u64 pos) const;
+        u64 size() const;
+        std::string substr(u64 pos, u64 length) const;
+
+        // Text properties
+        std::string_view getBody() const;
+        std::optional<char> getTerminator() const;
+
+        // Bytes of heap memory owned by the text (borrowed and mapped bytes are not counted)
+        u64 ownedBytes() const;
+
+    private:
+        Text(std::string_view body, std::shared_ptr<const void> storage, 
+             u64 ownedSize, std::optional<char> terminator);
+
+        std::string_view body;
+        std::shared_ptr<const void> storage;  // Keeps copied or mapped bytes alive
+        std::string* owned = nullptr;         // The copied bytes, the only storage that can grow
+        u64 ownedSize;
+        char terminator;
+        bool terminated;
+    };
+
+    inline char Text::operator[](u64 pos) const {
+        return pos < body.size() ? body[pos] : terminator;
+    }
+
+    inline u64 Text::size() const {
+        return body.size() + (terminated ? 1 : 0);
+    }
+}
+
+#endif // TEXT_HPP
@@ -0,0 +1,35 @@
+#ifndef TEXT_INDEX_HPP
+#define TEXT_INDEX_HPP
+
+#include "../type_aliases.hpp"
+#include <concepts>
+#include <string>
+#include <vector>
+#include <set>
+#include <span>
+
+namespace lab {
+
+    // Occurrence views: 32-bit positions, or 64-bit ones for texts beyond 4 GB
+    template <class Occurrences>
+    concept OccurrenceSpan = std::same_as<Occurrences, std::span<const u32>> ||
+                             std::same_as<Occurrences, std::span<const u64>>;
+
+    // Queries answered by every engine, including those only loaded from disk
+    template <class Index>
+    concept PatternIndex = requires(const Index& index, const std::string& s) {
+            { index.searchPattern(s) } -> std::same_as<std::set<u64>>;
+            { index.countPattern(s) } -> std::same_as<u64>;
+            { index.findOccurrences(s) } -> OccurrenceSpan;
+            { index.memoryUsage() } -> std::same_as<u64>;
+            { Index::findLCS(s, s) } -> std::same_as<std::pair<u64, std::vector<u64>>>;
+            { Index::findLCSString(s, s) } -> std::same_as<std::pair<u64, std::set<std::string>>>;
+        };
+
+    // Query interface shared by the interchangeable index engines
+    // (SuffixTree, SuffixArray, ...). The engine is picked by the type constructed.
+    template <class Index>
+    concept TextIndex = std::constructible_from<Index, const std::string&> && PatternIndex<Index>;
+}
+
+#endif // TEXT_INDEX_HPP
@@ -0,0 +1,78 @@
+#ifndef TREE_STATS_HPP
+#define TREE_STATS_HPP
+
+#include "../type_aliases.hpp"
+#include <chrono>
+#include <ostream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace lab {
+
+    // Construction event counters are only kept when the library is compiled
+    // with LAB_STATS (cmake -DLAB_STATS=ON); otherwise every update is discarded
+    // at compile time.
+#ifdef LAB_STATS
+    inline constexpr bool StatsEnabled = true;
+#else
+    inline constexpr bool StatsEnabled = false;
+#endif
+
+    // Shape of a suffix tree and, with LAB_STATS, what it cost to build
+    struct TreeStats {
+        // Shape, always available
+        u64 nodes = 0;
+        u64 leaves = 0;
+        u64 maxDepth = 0;       // Deepest node, in edges from the root
+        u64 bytes = 0;          // memoryUsage()
+
+        // Construction events, LAB_STATS only
+        u64 extensions = 0;           // Suffixes inserted as new leaves
+        u64 splits = 0;               // Edges split by a new internal node
+        u64 activePointHops = 0;      // Skip/count moves of the active point down an edge
+        u64 suffixLinkTraversals = 0; // Active node moves along a suffix link
+        std::vector<std::pair<std::string_view, double>> phases;  // Seconds per phase, summed over its runs
+    };
+
+    std::ostream& operator<<(std::ostream& os, const TreeStats& stats);
+
+    // Adds the lifetime of the timer to a phase of the stats, a no-op without
+    // LAB_STATS. Repeated phases (append, reindex) add up in a single entry.
+    class PhaseTimer {
+    public:
+        PhaseTimer(TreeStats& stats, std::string_view phase);
+        ~PhaseTimer();
+
+        PhaseTimer(const PhaseTimer&) = delete;
+        PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    private:
+        TreeStats& stats;
+        std::string_view phase;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    inline PhaseTimer::PhaseTimer(TreeStats& stats, std::string_view phase)
+        :   stats(stats),
+            phase(phase) {
+        if constexpr (StatsEnabled) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    inline PhaseTimer::~PhaseTimer() {
+        if constexpr (StatsEnabled) {
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            for (auto& [name, seconds] : stats.phases) {
+                if (name == phase) {
+                    seconds += elapsed.count();
+                    return;
+                }
+            }
+            stats.phases.emplace_back(phase, elapsed.count());
+        }
+    }
+}
+
+#endif // TREE_STATS_HPP
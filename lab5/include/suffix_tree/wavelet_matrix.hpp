@@ -0,0 +1,85 @@
+#ifndef WAVELET_MATRIX_HPP
+#define WAVELET_MATRIX_HPP
+
+#include "../type_aliases.hpp"
+#include <bit>
+#include <span>
+#include <vector>
+
+namespace lab {
+
+    // Fixed-size bit vector with constant-time rank: a cumulative count every
+    // BlockWords words, 12.5% on top of the bits
+    class RankBitVector {
+    public:
+        // Constructors, bits are set before build() and frozen after it
+        RankBitVector() = default;
+        explicit RankBitVector(u64 size);
+        void set(u64 pos);
+        void build();
+
+        // Queries, rank counts the bits in [0, pos)
+        bool operator[](u64 pos) const;
+        u64 rank1(u64 pos) const;
+        u64 rank0(u64 pos) const;
+
+        // Vector properties
+        u64 size() const;
+        u64 memoryUsage() const;
+
+    private:
+        static constexpr u64 BlockWords = 8;
+
+        std::vector<u64> words;
+        std::vector<u64> blockRanks;  // Ones before each block
+        u64 length = 0;
+    };
+
+    // Wavelet tree over symbols of a fixed bit width in the level-wise (matrix)
+    // layout: one bit vector per bit of the symbols, most significant first,
+    // each level stably partitioned by the bit above. Rank and access cost one
+    // bit vector rank per level.
+    class WaveletMatrix {
+    public:
+        // Constructors, every symbol must be below 2^bits
+        WaveletMatrix() = default;
+        WaveletMatrix(std::span<const u8> symbols, u32 bits);
+
+        // Occurrences of symbol in [0, pos)
+        u64 rank(u8 symbol, u64 pos) const;
+        u8 access(u64 pos) const;
+
+        // Matrix properties
+        u64 size() const;
+        u64 memoryUsage() const;
+
+    private:
+        std::vector<RankBitVector> levels;
+        std::vector<u64> zeros;  // Zeros of each level, where its ones start below
+        u64 length = 0;
+        u32 bits = 0;
+    };
+
+    inline bool RankBitVector::operator[](u64 pos) const {
+        return (words[pos / 64] >> (pos % 64)) & 1;
+    }
+
+    inline u64 RankBitVector::rank1(u64 pos) const {
+        u64 word = pos / 64;
+        u64 block = word / BlockWords;
+        u64 ones = blockRanks[block];
+        for (u64 i = block * BlockWords; i < word; ++i) {
+            ones += static_cast<u64>(std::popcount(words[i]));
+        }
+        if (pos % 64 != 0) {
+            ones += static_cast<u64>(std::popcount(words[word] & ((u64(1) << (pos % 64)) - 1)));
+        }
+        return ones;
+    }
+
+    inline u64 RankBitVector::rank0(u64 pos) const {
+        return pos - rank1(pos);
+    }
+}
+
+#endif // WAVELET_MATRIX_HPP
@@ -1,31 +1,371 @@
+#include <algorithm>
 #include <iostream>
-#include <set>
+#include <span>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <charconv>
+#include <optional>
+#include <type_traits>
+#include <unistd.h>
 
 #include <suffix_tree/suffix_tree.hpp>
+#include <suffix_tree/suffix_array.hpp>
+#include <suffix_tree/flat_suffix_tree.hpp>
+#include <suffix_tree/fm_index.hpp>
+#include <suffix_tree/disk_suffix_array.hpp>
+#include <suffix_tree/output_writer.hpp>
+#include <suffix_tree/parallel_for.hpp>
+#include <suffix_tree/query_cache.hpp>
+#include <suffix_tree/text_index.hpp>
 
 using namespace lab;
 
-int main() {
-    std::string text;
-    std::getline(std::cin, text);
+struct Options {
+    std::string_view engine = "tree";
+    std::string textFile;
+    std::string saveIndex;
+    std::string loadIndex;
+    std::string diskIndex;
+    u64 memoryBudget = u64(1) << 30;
+    u64 cacheBytes = 0;
+    bool stats = false;
+    bool batch = false;
+    bool freeze = false;
+    u32 sampleRate = FMIndex::DefaultSampleRate;
+    u32 threads = std::max(1u, std::thread::hardware_concurrency());
+    // The parallel build copies the text and holds the suffix and LCP arrays,
+    // so the tree is built in place by Ukkonen unless --threads asks otherwise
+    u32 buildThreads = 1;
+};
+
+// Appends "<count>: i1, i2, ..." with the sorted positions as 1-based
+// indexes, nothing when there are no occurrences
+void formatSorted(std::string& out, u64 count, std::span<const u64> positions) {
+    if (positions.empty()) {
+        return;
+    }
+    appendDecimal(out, count);
+    out += ": ";
+    auto i = positions.begin();
+    appendDecimal(out, *(i++) + 1);
+    while (i != positions.end()) {
+        out += ", ";
+        appendDecimal(out, *(i++) + 1);
+    }
+    out += "\n";
+}
 
-    SuffixTree tree(text + "$");
+// Same for unsorted occurrences, sorted in the reusable indexes buffer
+template <class Position>
+void formatOccurrences(std::string& out, u64 count, std::span<const Position> occurrences, std::vector<u64>& indexes) {
+    indexes.assign(occurrences.begin(), occurrences.end());
+    std::sort(indexes.begin(), indexes.end());
+    formatSorted(out, count, indexes);
+}
 
+// Appends the answer for one pattern, through the cache when there is one
+template <PatternIndex Index>
+void answer(std::string& out, u64 count, const Index& tree, const std::string& pattern,
+            QueryCache* cache, std::vector<u64>& indexes) {
+    if (cache == nullptr) {
+        formatOccurrences(out, count, tree.findOccurrences(pattern), indexes);
+        return;
+    }
+    QueryCache::Positions positions = cache->get(pattern, indexVersion(tree), [&]() {
+        auto occurrences = tree.findOccurrences(pattern);
+        std::vector<u64> sorted(occurrences.begin(), occurrences.end());
+        std::sort(sorted.begin(), sorted.end());
+        return sorted;
+    });
+    formatSorted(out, count, *positions);
+}
+
+// Answers patterns one at a time as they are read. Answers are flushed
+// whenever the next read would wait for input, so piped patterns share large
+// writes while a terminal still sees each answer at once.
+template <PatternIndex Index>
+void runInteractive(const Index& tree, QueryCache* cache, OutputWriter& writer) {
     std::string pattern;
+    std::string out;
+    std::vector<u64> indexes;
     u64 count = 1;
     while (std::getline(std::cin, pattern)) {
-        auto indexes = tree.searchPattern(pattern);
-        if (!indexes.empty()) {
-            std::cout << count << ": ";
-            auto i = indexes.begin();
-            std::cout << *(i++) + 1;
-            while (i != indexes.end()) {
-                std::cout  << ", " << *(i++) + 1;
-            }
-            std::cout << "\n";
+        out.clear();
+        answer(out, count, tree, pattern, cache, indexes);
+        writer.write(out);
+        if (std::cin.rdbuf()->in_avail() <= 0) {
+            writer.flush();
         }
         ++count;
     }
+}
+
+// Reads every pattern, answers them on a pool of workers sharing the index
+// and writes the results in input order as soon as each chunk is ready. The
+// first exception of a worker or of the writer stops the others and is
+// rethrown here once every worker has been joined.
+template <PatternIndex Index>
+void runBatch(const Index& tree, u32 threads, QueryCache* cache, OutputWriter& writer) {
+    constexpr u64 ChunkSize = 256;
+
+    std::vector<std::string> patterns;
+    for (std::string pattern; std::getline(std::cin, pattern);) {
+        patterns.push_back(std::move(pattern));
+    }
+
+    u64 chunks = (patterns.size() + ChunkSize - 1) / ChunkSize;
+    std::vector<std::string> outputs(chunks);
+    std::vector<char> ready(chunks, false);
+    std::atomic<u64> nextChunk = 0;
+    std::mutex mutex;
+    std::condition_variable chunkReady;
+    FirstError error;
+
+    // Keeps the first exception; no chunk is handed out after it. Captured
+    // under the mutex so that the writer cannot miss it between two waits.
+    auto fail = [&](std::exception_ptr exception) {
+        {
+            std::lock_guard lock(mutex);
+            error.capture(std::move(exception));
+        }
+        nextChunk = chunks;
+        chunkReady.notify_all();
+    };
+
+    auto worker = [&]() {
+        std::vector<u64> indexes;
+        for (u64 chunk = nextChunk++; chunk < chunks; chunk = nextChunk++) {
+            std::string out;
+            try {
+                u64 end = std::min<u64>(patterns.size(), (chunk + 1) * ChunkSize);
+                for (u64 i = chunk * ChunkSize; i < end; ++i) {
+                    answer(out, i + 1, tree, patterns[i], cache, indexes);
+                }
+            } catch (...) {
+                fail(std::current_exception());
+                return;
+            }
+            {
+                std::lock_guard lock(mutex);
+                outputs[chunk] = std::move(out);
+                ready[chunk] = true;
+            }
+            chunkReady.notify_one();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    try {
+        for (u32 i = 0; i < threads; ++i) {
+            pool.emplace_back(worker);
+        }
+        for (u64 chunk = 0; chunk < chunks; ++chunk) {
+            std::string out;
+            {
+                std::unique_lock lock(mutex);
+                chunkReady.wait(lock, [&]() { return ready[chunk] || error.failed(); });
+                if (error.failed()) {
+                    break;
+                }
+                out = std::move(outputs[chunk]);
+            }
+            writer.write(out);
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    error.rethrow();
+}
+
+// Builds the index over the text followed by the "$" terminator. The suffix
+// tree indexes the text in place with a virtual terminator, a mapped text file
+// is never copied into memory. An explicit --threads=N builds the tree with
+// N workers instead, at the cost of a copy of the text and the suffix arrays.
+template <TextIndex Index>
+Index makeIndex(const std::string& text, const Options& options) {
+    if constexpr (std::is_constructible_v<Index, Text>) {
+        if (!options.textFile.empty()) {
+            return Index(Text::map(options.textFile, '$'), options.buildThreads);
+        }
+        return Index(Text::borrow(text, '$'), options.buildThreads);
+    } else if constexpr (std::is_same_v<Index, FMIndex>) {
+        if (!options.textFile.empty()) {
+            return Index(std::string(Text::map(options.textFile).getBody()) + "$", options.sampleRate);
+        }
+        return Index(text + "$", options.sampleRate);
+    } else {
+        if (!options.textFile.empty()) {
+            return Index(std::string(Text::map(options.textFile).getBody()) + "$");
+        }
+        return Index(text + "$");
+    }
+}
+
+template <PatternIndex Index>
+int serve(const Index& tree, const Options& options) {
+    std::optional<QueryCache> cache;
+    if (options.cacheBytes > 0) {
+        cache.emplace(options.cacheBytes);
+    }
+    QueryCache* shared = cache ? &*cache : nullptr;
 
+    OutputWriter writer(STDOUT_FILENO);
+    if (options.batch) {
+        runBatch(tree, options.threads, shared, writer);
+    } else {
+        runInteractive(tree, shared, writer);
+    }
+    writer.flush();
+    if (cache && options.stats) {
+        std::cerr << cache->stats();
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+template <TextIndex Index>
+int run(const std::string& text, const Options& options) {
+    Index tree = makeIndex<Index>(text, options);
+    if constexpr (std::is_same_v<Index, SuffixTree>) {
+        if (!options.saveIndex.empty()) {
+            tree.save(options.saveIndex);
+        }
+        if (options.stats) {
+            std::cerr << tree.stats();
+        }
+        if (options.freeze) {
+            tree.freeze();
+        }
+    }
+    return serve(tree, options);
+}
+
+// Usage: lab_main [--engine=tree|array|fm] [--text-file=PATH] [--batch] [--threads=N]
+//                 [--save-index=PATH | --load-index=PATH] [--stats] [--sample-rate=N]
+//                 [--disk-index=PATH] [--memory-budget=BYTES] [--cache-bytes=BYTES] [--freeze]
+// The text is the first line of stdin unless --text-file or --load-index is
+// given, in which case every line of stdin is a pattern. --save-index writes
+// the built tree to PATH, --load-index maps a saved tree instead of building.
+// --stats prints the tree statistics to stderr once it is built (the tree
+// engine without --load-index or --disk-index). --sample-rate
+// sets how often the FM-index samples the suffix array: less memory for
+// sparser samples, longer locates. --disk-index serves an on-disk suffix
+// array from PATH, first building it from --text-file out of core with
+// --memory-budget bytes (1 GiB by default) when a text file is given.
+// --cache-bytes keeps the answers of repeated patterns in an LRU cache of at
+// most that many bytes, shared by the batch workers; --stats then also prints
+// its hit and miss counts once the patterns are answered. --freeze rewrites
+// the built tree into the flat layout before serving: faster lookups for a
+// one-off rewrite that briefly holds both layouts. Like --stats, it needs a
+// tree built here; a loaded index is already flat.
+int main(int argc, char** argv) {
+    // Answers bypass std::cout, stdin is read through its own buffer
+    std::ios::sync_with_stdio(false);
+
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--engine=")) {
+            options.engine = arg.substr(std::string_view("--engine=").size());
+        } else if (arg.starts_with("--text-file=")) {
+            options.textFile = arg.substr(std::string_view("--text-file=").size());
+        } else if (arg.starts_with("--save-index=")) {
+            options.saveIndex = arg.substr(std::string_view("--save-index=").size());
+        } else if (arg.starts_with("--load-index=")) {
+            options.loadIndex = arg.substr(std::string_view("--load-index=").size());
+        } else if (arg.starts_with("--disk-index=")) {
+            options.diskIndex = arg.substr(std::string_view("--disk-index=").size());
+        } else if (arg.starts_with("--memory-budget=")) {
+            auto value = arg.substr(std::string_view("--memory-budget=").size());
+            auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), options.memoryBudget);
+            if (error != std::errc() || end != value.data() + value.size() || options.memoryBudget < DiskSuffixArray::MinMemoryBudget) {
+                std::cerr << "Invalid memory budget: " << value << "\n";
+                return 1;
+            }
+        } else if (arg.starts_with("--cache-bytes=")) {
+            auto value = arg.substr(std::string_view("--cache-bytes=").size());
+            auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), options.cacheBytes);
+            if (error != std::errc() || end != value.data() + value.size()) {
+                std::cerr << "Invalid cache size: " << value << "\n";
+                return 1;
+            }
+        } else if (arg == "--stats") {
+            options.stats = true;
+        } else if (arg == "--freeze") {
+            options.freeze = true;
+        } else if (arg == "--batch") {
+            options.batch = true;
+        } else if (arg.starts_with("--sample-rate=")) {
+            auto value = arg.substr(std::string_view("--sample-rate=").size());
+            auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), options.sampleRate);
+            if (error != std::errc() || end != value.data() + value.size() || options.sampleRate == 0) {
+                std::cerr << "Invalid sample rate: " << value << "\n";
+                return 1;
+            }
+        } else if (arg.starts_with("--threads=")) {
+            auto value = arg.substr(std::string_view("--threads=").size());
+            auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), options.threads);
+            if (error != std::errc() || end != value.data() + value.size() || options.threads == 0) {
+                std::cerr << "Invalid thread count: " << value << "\n";
+                return 1;
+            }
+            options.buildThreads = options.threads;
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            return 1;
+        }
+    }
+    if (options.engine != "tree" && options.engine != "array" && options.engine != "fm") {
+        std::cerr << "Unknown engine: " << options.engine << "\n";
+        return 1;
+    }
+    if (!options.saveIndex.empty() && options.engine != "tree") {
+        std::cerr << "--save-index requires the tree engine\n";
+        return 1;
+    }
+    // Tree statistics come from a tree built here, not from a loaded index
+    bool buildsTree = options.engine == "tree" && options.loadIndex.empty() && options.diskIndex.empty();
+    if (options.stats && !buildsTree && options.cacheBytes == 0) {
+        std::cerr << "--stats requires building the tree engine, or --cache-bytes\n";
+        return 1;
+    }
+    if (options.freeze && !buildsTree) {
+        std::cerr << "--freeze requires building the tree engine\n";
+        return 1;
+    }
+
+    std::string text;
+    if (options.textFile.empty() && options.loadIndex.empty() && options.diskIndex.empty()) {
+        std::getline(std::cin, text);
+    }
+
+    try {
+        if (!options.loadIndex.empty()) {
+            return serve(FlatSuffixTree::load(options.loadIndex), options);
+        }
+        if (!options.diskIndex.empty()) {
+            if (!options.textFile.empty()) {
+                DiskSuffixArray::build(options.textFile, options.diskIndex, options.memoryBudget, '$');
+            }
+            return serve(DiskSuffixArray::load(options.diskIndex), options);
+        }
+        if (options.engine == "array") {
+            return run<SuffixArray>(text, options);
+        }
+        if (options.engine == "fm") {
+            return run<FMIndex>(text, options);
+        }
+        return run<SuffixTree>(text, options);
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef ALLOCATION_COUNTER_HPP
+#define ALLOCATION_COUNTER_HPP
+
+#include "type_aliases.hpp"
+
+namespace lab {
+
+    // Heap allocations made so far by the calling thread. Counted by the global
+    // operator new of allocation_counter.cpp, which only the allocation tests
+    // link; it lives in its own translation unit so that no new-expression is
+    // ever inlined against its matching delete.
+    u64 threadAllocations();
+}
+
+#endif // ALLOCATION_COUNTER_HPP
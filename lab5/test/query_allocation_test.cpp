@@ -0,0 +1,68 @@
+#include "allocation_counter.hpp"
+#include "suffix_tree/suffix_tree.hpp"
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace lab;
+
+std::string randomText(u64 size, std::string const& alphabet, u64 seed) {
+    std::mt19937_64 rng(seed);
+    std::string text(size, ' ');
+    for (auto& c : text) {
+        c = alphabet[rng() % alphabet.size()];
+    }
+    return text;
+}
+
+// Patterns sampled from the text, with misses, to query a tree with
+std::vector<std::string> samplePatterns(const std::string& text, u64 count, u64 seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<std::string> patterns;
+    for (u64 i = 0; i < count; ++i) {
+        std::string pattern = text.substr(rng() % (text.size() - 40), 1 + rng() % 40);
+        if (i % 5 == 0) {
+            pattern.back() = '#';
+        }
+        patterns.push_back(pattern);
+    }
+    return patterns;
+}
+
+// Test that queries on an indexed tree allocate nothing, and on a tree grown by
+// appends nothing once the per-thread buffers have grown
+TEST(ConstQueryTest, NoAllocations) {
+    std::string text = randomText(50000, "acgt", 61);
+    const SuffixTree indexed(text + "$");
+    SuffixTree grown(text.substr(0, 40000));
+    grown.append(std::string_view(text).substr(40000));
+    std::vector<std::string> patterns = samplePatterns(text, 500, 62);
+
+    for (const SuffixTree* tree : {&indexed, static_cast<const SuffixTree*>(&grown)}) {
+        u64 total = 0;
+        for (const std::string& pattern : patterns) {
+            total += tree->findOccurrences(pattern).size() + tree->countPattern(pattern);
+        }
+        u64 before = threadAllocations();
+        for (const std::string& pattern : patterns) {
+            total -= tree->findOccurrences(std::string_view(pattern)).size() + tree->countPattern(pattern);
+        }
+        EXPECT_EQ(threadAllocations(), before);
+        EXPECT_EQ(total, 0u);
+    }
+}
+
+// Test that the counter sees the allocations it is meant to catch
+TEST(ConstQueryTest, CounterSeesAllocations) {
+    SuffixTree tree(std::string("banana$"));
+    u64 before = threadAllocations();
+    std::set<u64> occurrences = tree.searchPattern("ana");
+    EXPECT_GT(threadAllocations(), before);
+    EXPECT_EQ(occurrences.size(), 2u);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  
+  return RUN_ALL_TESTS();
+}
@@ -1,6 +1,28 @@
 #include "suffix_tree/suffix_tree.hpp"
+#include "suffix_tree/alphabet_suffix_tree.hpp"
+#include "suffix_tree/suffix_array.hpp"
+#include "suffix_tree/flat_suffix_tree.hpp"
+#include "suffix_tree/fm_index.hpp"
+#include "suffix_tree/disk_suffix_array.hpp"
+#include "suffix_tree/generalized_suffix_tree.hpp"
+#include "suffix_tree/text_index.hpp"
+#include "suffix_tree/output_writer.hpp"
+#include "suffix_tree/parallel_for.hpp"
+#include "suffix_tree/query_cache.hpp"
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <limits>
+#include <map>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <tuple>
 
 using namespace lab;
 
@@ -56,16 +78,27 @@ TEST_F(SuffixTreeTest, EmptyPatternShouldReturnTrue) {
 
 #endif
 
+// Every engine runs the same query suites
+using Engines = ::testing::Types<SuffixTree, SuffixArray>;
+using QueryEngines = ::testing::Types<SuffixTree, SuffixArray, FlatSuffixTree, FMIndex>;
+
+static_assert(TextIndex<SuffixTree>);
+static_assert(TextIndex<SuffixArray>);
+static_assert(TextIndex<FlatSuffixTree>);
+static_assert(TextIndex<FMIndex>);
+static_assert(PatternIndex<DiskSuffixArray>);
+
 #ifndef TEST_LCS
 #define TEST_LCS
 
+template <class Index>
 void testLCS(
     std::string const& s1, 
     std::string const& s2,
     u64 length,
     std::initializer_list<u64> indexes
 ) {
-    auto [_length, _indexes] = SuffixTree::findLCS(s1, s2);
+    auto [_length, _indexes] = Index::findLCS(s1, s2);
     EXPECT_EQ(_length, length);
     EXPECT_EQ(
         _indexes, 
@@ -73,229 +106,240 @@ void testLCS(
     );
 }
 
+template <class Index>
+class SuffixTreeFindLCSTest : public ::testing::Test {};
+TYPED_TEST_SUITE(SuffixTreeFindLCSTest, Engines);
+
 // Test cases for findLCS
-TEST(SuffixTreeFindLCSTest, LCSExistsBetweenTwoStrings) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSExistsBetweenTwoStrings) {
     std::string s1 = "banana";
     std::string s2 = "bandana";
-    testLCS(s1, s2, 3, {0, 1});
+    testLCS<TypeParam>(s1, s2, 3, {0, 1});
 }
 
-TEST(SuffixTreeFindLCSTest, NoCommonSubstring) {
+TYPED_TEST(SuffixTreeFindLCSTest, NoCommonSubstring) {
     std::string s1 = "abc";
     std::string s2 = "xyz";
-    testLCS(s1, s2, 0, {});
+    testLCS<TypeParam>(s1, s2, 0, {});
 }
 
-TEST(SuffixTreeFindLCSTest, LCSIsFullString) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSIsFullString) {
     std::string s1 = "apple";
     std::string s2 = "apple";
-    testLCS(s1, s2, 5, {0});
+    testLCS<TypeParam>(s1, s2, 5, {0});
 }
 
-TEST(SuffixTreeFindLCSTest, LCSWithPartialOverlap) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSWithPartialOverlap) {
     std::string s1 = "abcdef";
     std::string s2 = "defabc";
-    testLCS(s1, s2, 3, {0, 3});
+    testLCS<TypeParam>(s1, s2, 3, {0, 3});
 }
 
-TEST(SuffixTreeFindLCSTest, LCSLongOverlap) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSLongOverlap) {
     std::string s1 = "aabcaabc";
     std::string s2 = "abcaabc";
-    testLCS(s1, s2, 7, {1});
+    testLCS<TypeParam>(s1, s2, 7, {1});
 }
 
 // Additional test cases for findLCS
-TEST(SuffixTreeFindLCSTest, LCSOneCharacterMatch) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSOneCharacterMatch) {
     std::string s1 = "a";
     std::string s2 = "a";
-    testLCS(s1, s2, 1, {0});
+    testLCS<TypeParam>(s1, s2, 1, {0});
 }
 
-TEST(SuffixTreeFindLCSTest, LCSNoMatchSingleCharacters) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSNoMatchSingleCharacters) {
     std::string s1 = "a";
     std::string s2 = "b";
-    testLCS(s1, s2, 0, {});
+    testLCS<TypeParam>(s1, s2, 0, {});
 }
 
-TEST(SuffixTreeFindLCSTest, LCSNoMatchEmptyString) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSNoMatchEmptyString) {
     std::string s1 = "";
     std::string s2 = "nonempty";
-    testLCS(s1, s2, 0, {});
+    testLCS<TypeParam>(s1, s2, 0, {});
 }
 
-TEST(SuffixTreeFindLCSTest, LCSOneStringEmpty) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSOneStringEmpty) {
     std::string s1 = "nonempty";
     std::string s2 = "";
-    testLCS(s1, s2, 0, {});
+    testLCS<TypeParam>(s1, s2, 0, {});
 }
 
-TEST(SuffixTreeFindLCSTest, LCSDifferentCaseSensitivity) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSDifferentCaseSensitivity) {
     std::string s1 = "abcdef";
     std::string s2 = "ABCDEF";
-    testLCS(s1, s2, 0, {}); // assuming case-sensitive comparison
+    testLCS<TypeParam>(s1, s2, 0, {}); // assuming case-sensitive comparison
 }
 
-TEST(SuffixTreeFindLCSTest, LCSMultipleMatchesSameLength) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSMultipleMatchesSameLength) {
     std::string s1 = "abababab";
     std::string s2 = "babababa";
-    testLCS(s1, s2, 7, {0, 1}); // longest matches could start at index 0 or 1
+    testLCS<TypeParam>(s1, s2, 7, {0, 1}); // longest matches could start at index 0 or 1
 }
 
-TEST(SuffixTreeFindLCSTest, LCSLongRepeatingSubstring) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSLongRepeatingSubstring) {
     std::string s1 = "aaaaaaa";
     std::string s2 = "aaaa";
-    testLCS(s1, s2, 4, {0});
+    testLCS<TypeParam>(s1, s2, 4, {0});
 }
 
-TEST(SuffixTreeFindLCSTest, LCSEqualStringsDifferentLengths) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSEqualStringsDifferentLengths) {
     std::string s1 = "abcde";
     std::string s2 = "abc";
-    testLCS(s1, s2, 3, {0});
+    testLCS<TypeParam>(s1, s2, 3, {0});
 }
 
-TEST(SuffixTreeFindLCSTest, LCSLongerInMiddle) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSLongerInMiddle) {
     std::string s1 = "xyzabcdxyz";
     std::string s2 = "pqrabcdpqr";
-    testLCS(s1, s2, 4, {3});
+    testLCS<TypeParam>(s1, s2, 4, {3});
 }
 
-TEST(SuffixTreeFindLCSTest, LCSMixedAlphaNumeric) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSMixedAlphaNumeric) {
     std::string s1 = "abc123def";
     std::string s2 = "123ghi";
-    testLCS(s1, s2, 3, {3});
+    testLCS<TypeParam>(s1, s2, 3, {3});
 }
 
-TEST(SuffixTreeFindLCSTest, LCSWithSpecialCharacters) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSWithSpecialCharacters) {
     std::string s1 = "hello|world";
     std::string s2 = "world|hello";
-    testLCS(s1, s2, 5, {0, 6});
+    testLCS<TypeParam>(s1, s2, 5, {0, 6});
 }
 
-TEST(SuffixTreeFindLCSTest, LCSCommonPrefixOnly) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSCommonPrefixOnly) {
     std::string s1 = "commonprefix123";
     std::string s2 = "commonprefix456";
-    testLCS(s1, s2, 12, {0});
+    testLCS<TypeParam>(s1, s2, 12, {0});
 }
 
-TEST(SuffixTreeFindLCSTest, LCSCommonSuffixOnly) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSCommonSuffixOnly) {
     std::string s1 = "123commonsuffix";
     std::string s2 = "456commonsuffix";
-    testLCS(s1, s2, 12, {3});
+    testLCS<TypeParam>(s1, s2, 12, {3});
 }
 
-TEST(SuffixTreeFindLCSTest, LCSRandomCharacters) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSRandomCharacters) {
     std::string s1 = "afhgtc";
     std::string s2 = "bhgtfc";
-    testLCS(s1, s2, 3, {2});
+    testLCS<TypeParam>(s1, s2, 3, {2});
 }
 
-TEST(SuffixTreeFindLCSTest, LCSLongNoCommon) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSLongNoCommon) {
     std::string s1 = "abcdefghijklm";
     std::string s2 = "nopqrstuvwxyz";
-    testLCS(s1, s2, 0, {});
+    testLCS<TypeParam>(s1, s2, 0, {});
 }
 
-TEST(SuffixTreeFindLCSTest, LCSEmptyStrings) {
-    testLCS("", "", 0, {});
+TYPED_TEST(SuffixTreeFindLCSTest, LCSEmptyStrings) {
+    testLCS<TypeParam>("", "", 0, {});
 }
 
 // Extensive test cases for findLCS
 
 // Test with large identical strings
-TEST(SuffixTreeFindLCSTest, LargeIdenticalStrings) {
+TYPED_TEST(SuffixTreeFindLCSTest, LargeIdenticalStrings) {
     std::string s1(1000, 'a');
     std::string s2(1000, 'a');
-    testLCS(s1, s2, 1000, {0});
+    testLCS<TypeParam>(s1, s2, 1000, {0});
+}
+
+// Test with repetitive strings whose tree is as deep as the text is long
+TYPED_TEST(SuffixTreeFindLCSTest, DeepRepetitiveStrings) {
+    std::string s1(300000, 'a');
+    std::string s2(200000, 'a');
+    testLCS<TypeParam>(s1, s2, 200000, {0});
 }
 
 // Test with large strings with no common substring
-TEST(SuffixTreeFindLCSTest, LargeNoCommonSubstring) {
+TYPED_TEST(SuffixTreeFindLCSTest, LargeNoCommonSubstring) {
     std::string s1(1000, 'a');
     std::string s2(1000, 'b');
-    testLCS(s1, s2, 0, {});
+    testLCS<TypeParam>(s1, s2, 0, {});
 }
 
 // Test with long string where LCS is a substring in the middle
-TEST(SuffixTreeFindLCSTest, LCSInMiddleOfLongString) {
+TYPED_TEST(SuffixTreeFindLCSTest, LCSInMiddleOfLongString) {
     std::string s1 = "xyz" + std::string(100, 'a') + "middle" + std::string(100, 'b') + "end";
     std::string s2 = "start" + std::string(100, 'c') + "middle" + std::string(100, 'd') + "xyz";
-    testLCS(s1, s2, 6, {103}); // "middle" common substring starts at index 103 in s1
+    testLCS<TypeParam>(s1, s2, 6, {103}); // "middle" common substring starts at index 103 in s1
 }
 
 // Test with long strings with partial overlapping patterns
-TEST(SuffixTreeFindLCSTest, PartialOverlapWithLargeStrings) {
+TYPED_TEST(SuffixTreeFindLCSTest, PartialOverlapWithLargeStrings) {
     std::string s1 = "a" + std::string(500, 'b') + "cdef";
     std::string s2 = "b" + std::string(500, 'b') + "cdef";
-    testLCS(s1, s2, 504, {1});
+    testLCS<TypeParam>(s1, s2, 504, {1});
 }
 
 // Test with alternating character pattern
-TEST(SuffixTreeFindLCSTest, AlternatingPatternStrings) {
+TYPED_TEST(SuffixTreeFindLCSTest, AlternatingPatternStrings) {
     std::string s1 = "abababababab";
     std::string s2 = "babababababa";
-    testLCS(s1, s2, 11, {0, 1}); // Largest common substring is nearly the full string
+    testLCS<TypeParam>(s1, s2, 11, {0, 1}); // Largest common substring is nearly the full string
 }
 
 // Test with palindrome pattern
-TEST(SuffixTreeFindLCSTest, PalindromicPattern) {
+TYPED_TEST(SuffixTreeFindLCSTest, PalindromicPattern) {
     std::string s1 = "racecar";
     std::string s2 = "carrace";
-    testLCS(s1, s2, 4, {0}); // Longest common substrings start at multiple positions
+    testLCS<TypeParam>(s1, s2, 4, {0}); // Longest common substrings start at multiple positions
 }
 
 // Test where LCS has special characters and spaces
-TEST(SuffixTreeFindLCSTest, SpecialCharactersAndSpaces) {
+TYPED_TEST(SuffixTreeFindLCSTest, SpecialCharactersAndSpaces) {
     std::string s1 = "Hello, World! How are you?";
     std::string s2 = "World! How is everyone?";
-    testLCS(s1, s2, 11, {7}); // Longest common substring "World! "
+    testLCS<TypeParam>(s1, s2, 11, {7}); // Longest common substring "World! "
 }
 
 // Test with common substring appearing at the start and end
-TEST(SuffixTreeFindLCSTest, CommonSubstringAtStartAndEnd) {
+TYPED_TEST(SuffixTreeFindLCSTest, CommonSubstringAtStartAndEnd) {
     std::string s1 = "prefix_common_suffix";
     std::string s2 = "common";
-    testLCS(s1, s2, 6, {7});
+    testLCS<TypeParam>(s1, s2, 6, {7});
 }
 
 // Test with overlapping numbers
-TEST(SuffixTreeFindLCSTest, OverlappingNumbers) {
+TYPED_TEST(SuffixTreeFindLCSTest, OverlappingNumbers) {
     std::string s1 = "123451234512345";
     std::string s2 = "4512345";
-    testLCS(s1, s2, 7, {3});
+    testLCS<TypeParam>(s1, s2, 7, {3});
 }
 
 // Test with repeated long substring
-TEST(SuffixTreeFindLCSTest, LongRepeatedSubstring) {
+TYPED_TEST(SuffixTreeFindLCSTest, LongRepeatedSubstring) {
     std::string s1 = "repeatrepeatrepeatrepeat";
     std::string s2 = "repeatrepeat";
-    testLCS(s1, s2, 12, {0}); // "repeatrepeat" appears multiple times in s1
+    testLCS<TypeParam>(s1, s2, 12, {0}); // "repeatrepeat" appears multiple times in s1
 }
 
 // Test with one string fully contained in the other
-TEST(SuffixTreeFindLCSTest, OneStringFullyContained) {
+TYPED_TEST(SuffixTreeFindLCSTest, OneStringFullyContained) {
     std::string s1 = "thisisaverylongstring";
     std::string s2 = "longstring";
-    testLCS(s1, s2, 10, {11});
+    testLCS<TypeParam>(s1, s2, 10, {11});
 }
 
 // Test with overlapping symbols
-TEST(SuffixTreeFindLCSTest, OverlappingSymbols) {
+TYPED_TEST(SuffixTreeFindLCSTest, OverlappingSymbols) {
     std::string s1 = "&&&&";
     std::string s2 = "&&&&&&";
-    testLCS(s1, s2, 4, {0});
+    testLCS<TypeParam>(s1, s2, 4, {0});
 }
 
 // Test with partial match near end of strings
-TEST(SuffixTreeFindLCSTest, PartialMatchNearEnd) {
+TYPED_TEST(SuffixTreeFindLCSTest, PartialMatchNearEnd) {
     std::string s1 = "abcdef12345";
     std::string s2 = "xyz12345";
-    testLCS(s1, s2, 5, {6});
+    testLCS<TypeParam>(s1, s2, 5, {6});
 }
 
-TEST(SuffixTreeFindLCSTest, LongString) {
+TYPED_TEST(SuffixTreeFindLCSTest, LongString) {
     std::string s1 = "We still need to insert the final suffix of the current step, x. Since the active_length component of the active node has fallen to 0, the final insert is made at the root directly. Since there is no outgoing edge at the root node starting with x, we insert a new edge:";
     std::string s2 = "suffix curren compon";
-    testLCS(s1, s2, 7, {34, 47, 88});
+    testLCS<TypeParam>(s1, s2, 7, {34, 47, 88});
 }
 
 #endif
@@ -303,13 +347,14 @@ TEST(SuffixTreeFindLCSTest, LongString) {
 #ifndef TEST_LCS_STRING
 #define TEST_LCS_STRING
 
+template <class Index>
 void testLCSString(
     std::string const& s1,
     std::string const& s2,
     u64 length,
     std::initializer_list<std::string> lcs
 ) {
-    auto [_length, _lcs] = SuffixTree::findLCSString(s1, s2);
+    auto [_length, _lcs] = Index::findLCSString(s1, s2);
     EXPECT_EQ(_length, length);
     EXPECT_EQ(
         _lcs, 
@@ -317,121 +362,1364 @@ void testLCSString(
     );
 }
 
+template <class Index>
+class SuffixTreeFindLCSStringTest : public ::testing::Test {};
+TYPED_TEST_SUITE(SuffixTreeFindLCSStringTest, Engines);
+
 // Extensive test cases for findLCSString
 
 // Test with single common substring
-TEST(SuffixTreeFindLCSStringTest, SingleCommonSubstring) {
+TYPED_TEST(SuffixTreeFindLCSStringTest, SingleCommonSubstring) {
     std::string s1 = "banana";
     std::string s2 = "bandana";
-    testLCSString(s1, s2, 3, {"ana", "ban"});
+    testLCSString<TypeParam>(s1, s2, 3, {"ana", "ban"});
 }
 
 // Test with no common substring
-TEST(SuffixTreeFindLCSStringTest, NoCommonSubstring) {
+TYPED_TEST(SuffixTreeFindLCSStringTest, NoCommonSubstring) {
     std::string s1 = "abc";
     std::string s2 = "xyz";
-    testLCSString(s1, s2, 0, {});
+    testLCSString<TypeParam>(s1, s2, 0, {});
 }
 
 // Test with entire string as LCS
-TEST(SuffixTreeFindLCSStringTest, EntireStringAsLCS) {
+TYPED_TEST(SuffixTreeFindLCSStringTest, EntireStringAsLCS) {
     std::string s1 = "apple";
     std::string s2 = "apple";
-    testLCSString(s1, s2, 5, {"apple"});
+    testLCSString<TypeParam>(s1, s2, 5, {"apple"});
 }
 
 // Test with partial overlap
-TEST(SuffixTreeFindLCSStringTest, PartialOverlap) {
+TYPED_TEST(SuffixTreeFindLCSStringTest, PartialOverlap) {
     std::string s1 = "abcdef";
     std::string s2 = "defabc";
-    testLCSString(s1, s2, 3, {"abc", "def"});
+    testLCSString<TypeParam>(s1, s2, 3, {"abc", "def"});
 }
 
 // Test with repeating pattern
-TEST(SuffixTreeFindLCSStringTest, RepeatingPattern) {
+TYPED_TEST(SuffixTreeFindLCSStringTest, RepeatingPattern) {
     std::string s1 = "abababab";
     std::string s2 = "babababa";
-    testLCSString(s1, s2, 7, {"abababa", "bababab"});
+    testLCSString<TypeParam>(s1, s2, 7, {"abababa", "bababab"});
 }
 
 // Test with different case sensitivity
-TEST(SuffixTreeFindLCSStringTest, CaseSensitive) {
+TYPED_TEST(SuffixTreeFindLCSStringTest, CaseSensitive) {
     std::string s1 = "ABCabc";
     std::string s2 = "abcABC";
-    testLCSString(s1, s2, 3, {"ABC", "abc"});
+    testLCSString<TypeParam>(s1, s2, 3, {"ABC", "abc"});
 }
 
 // Test with palindromic substrings
-TEST(SuffixTreeFindLCSStringTest, PalindromicSubstring) {
+TYPED_TEST(SuffixTreeFindLCSStringTest, PalindromicSubstring) {
     std::string s1 = "racecar";
     std::string s2 = "carrace";
-    testLCSString(s1, s2, 4, {"race"});
+    testLCSString<TypeParam>(s1, s2, 4, {"race"});
 }
 
 // Test with mixed alphanumeric characters
-TEST(SuffixTreeFindLCSStringTest, MixedAlphanumeric) {
+TYPED_TEST(SuffixTreeFindLCSStringTest, MixedAlphanumeric) {
     std::string s1 = "abc123def";
     std::string s2 = "xyz123ghi";
-    testLCSString(s1, s2, 3, {"123"});
+    testLCSString<TypeParam>(s1, s2, 3, {"123"});
 }
 
 // Test with special characters
-TEST(SuffixTreeFindLCSStringTest, SpecialCharacters) {
+TYPED_TEST(SuffixTreeFindLCSStringTest, SpecialCharacters) {
     std::string s1 = "Hello, World!";
     std::string s2 = "Hi, World!";
-    testLCSString(s1, s2, 8, {", World!"});
+    testLCSString<TypeParam>(s1, s2, 8, {", World!"});
 }
 
 // Test with empty strings
-TEST(SuffixTreeFindLCSStringTest, EmptyStrings) {
+TYPED_TEST(SuffixTreeFindLCSStringTest, EmptyStrings) {
     std::string s1 = "";
     std::string s2 = "";
-    testLCSString(s1, s2, 0, {});
+    testLCSString<TypeParam>(s1, s2, 0, {});
 }
 
 // Test where one string is empty
-TEST(SuffixTreeFindLCSStringTest, OneStringEmpty) {
+TYPED_TEST(SuffixTreeFindLCSStringTest, OneStringEmpty) {
     std::string s1 = "nonempty";
     std::string s2 = "";
-    testLCSString(s1, s2, 0, {});
+    testLCSString<TypeParam>(s1, s2, 0, {});
 }
 
 // Test with long repeating substrings
-TEST(SuffixTreeFindLCSStringTest, LongRepeatingSubstring) {
+TYPED_TEST(SuffixTreeFindLCSStringTest, LongRepeatingSubstring) {
     std::string s1 = "repeatrepeatrepeat";
     std::string s2 = "repeatrepeat";
-    testLCSString(s1, s2, 12, {"repeatrepeat"});
+    testLCSString<TypeParam>(s1, s2, 12, {"repeatrepeat"});
 }
 
 // Test with overlapping numbers
-TEST(SuffixTreeFindLCSStringTest, OverlappingNumbers) {
+TYPED_TEST(SuffixTreeFindLCSStringTest, OverlappingNumbers) {
     std::string s1 = "1234512345";
     std::string s2 = "4512345";
-    testLCSString(s1, s2, 7, {"4512345"});
+    testLCSString<TypeParam>(s1, s2, 7, {"4512345"});
 }
 
 // Test with common prefix only
-TEST(SuffixTreeFindLCSStringTest, CommonPrefixOnly) {
+TYPED_TEST(SuffixTreeFindLCSStringTest, CommonPrefixOnly) {
     std::string s1 = "commonprefix123";
     std::string s2 = "commonprefix456";
-    testLCSString(s1, s2, 12, {"commonprefix"});
+    testLCSString<TypeParam>(s1, s2, 12, {"commonprefix"});
 }
 
 // Test with common suffix only
-TEST(SuffixTreeFindLCSStringTest, CommonSuffixOnly) {
+TYPED_TEST(SuffixTreeFindLCSStringTest, CommonSuffixOnly) {
     std::string s1 = "123commonsuffix";
     std::string s2 = "456commonsuffix";
-    testLCSString(s1, s2, 12, {"commonsuffix"});
+    testLCSString<TypeParam>(s1, s2, 12, {"commonsuffix"});
 }
 
 // Test with multiple common substrings, including special characters and spaces
-TEST(SuffixTreeFindLCSStringTest, CommonSubstringWithSpaces) {
+TYPED_TEST(SuffixTreeFindLCSStringTest, CommonSubstringWithSpaces) {
     std::string s1 = "Hello World! How are you?";
     std::string s2 = "Hello World! Everyone here?";
-    testLCSString(s1, s2, 13, {"Hello World! "});
+    testLCSString<TypeParam>(s1, s2, 13, {"Hello World! "});
+}
+
+
+
+#endif
+
+#ifndef TEST_SUFFIX_ARRAY
+#define TEST_SUFFIX_ARRAY
+
+std::string randomText(u64 size, std::string const& alphabet, u64 seed) {
+    std::mt19937_64 rng(seed);
+    std::string text(size, ' ');
+    for (auto& c : text) {
+        c = alphabet[rng() % alphabet.size()];
+    }
+    return text;
+}
+
+// Test SA-IS and Kasai against direct suffix comparison
+TEST(SuffixArrayTest, MatchesNaiveConstruction) {
+    for (u64 seed = 0; seed < 20; ++seed) {
+        std::string text = randomText(1 + seed * 37, seed % 2 ? "ab" : "acgt\xff", seed);
+        SuffixArray array(text);
+
+        std::vector<u64> expected(text.size());
+        for (u64 i = 0; i < text.size(); ++i) {
+            expected[i] = i;
+        }
+        std::sort(expected.begin(), expected.end(), [&](u64 l, u64 r) {
+            return text.compare(l, std::string::npos, text, r, std::string::npos) < 0;
+        });
+
+        ASSERT_EQ(array.getSize(), text.size());
+        for (u64 i = 0; i < text.size(); ++i) {
+            EXPECT_EQ(array.getSuffix(i), expected[i]);
+            if (i > 0) {
+                u64 h = 0;
+                while (expected[i] + h < text.size() && expected[i - 1] + h < text.size() &&
+                       text[expected[i] + h] == text[expected[i - 1] + h]) {
+                    ++h;
+                }
+                EXPECT_EQ(array.getLcp(i), h);
+            }
+        }
+    }
+}
+
+// Test that both engines report the same occurrences
+TEST(SuffixArrayTest, SearchMatchesSuffixTree) {
+    std::string text = randomText(2000, "abc", 1) + "$";
+    SuffixTree tree(text);
+    SuffixArray array(text);
+    std::mt19937_64 rng(2);
+    for (int i = 0; i < 500; ++i) {
+        std::string pattern = randomText(1 + rng() % 8, "abcd", rng());
+        EXPECT_EQ(array.searchPattern(pattern), tree.searchPattern(pattern)) << pattern;
+    }
+    EXPECT_EQ(array.searchPattern(""), std::set<u64>{});
+}
+
+#endif
+
+#ifndef TEST_TEXT
+#define TEST_TEXT
+
+std::string printed(SuffixTree const& tree) {
+    std::ostringstream out;
+    out << tree;
+    return out.str();
+}
+
+// Test that the virtual terminator reads like a stored one
+TEST(TextTest, VirtualTerminator) {
+    std::string body = "abcab";
+    Text text = Text::borrow(body, '$');
+    EXPECT_EQ(text.size(), 6u);
+    EXPECT_EQ(text[4], 'b');
+    EXPECT_EQ(text[5], '$');
+    EXPECT_EQ(text.substr(3, 10), "ab$");
+    EXPECT_EQ(text.ownedBytes(), 0u);
+    EXPECT_EQ(Text::copy(body).size(), 5u);
+}
+
+// Test that a borrowed text with a virtual terminator builds the same tree as a copied one
+TEST(TextTest, BorrowedTextBuildsSameTree) {
+    std::string body = randomText(3000, "abc", 5);
+    SuffixTree copied(body + "$");
+    SuffixTree borrowed(Text::borrow(body, '$'));
+    EXPECT_EQ(printed(borrowed), printed(copied));
+    EXPECT_EQ(borrowed.searchPattern("abca"), copied.searchPattern("abca"));
+}
+
+// Test indexing a memory-mapped file in place
+TEST(TextTest, MappedFileBuildsSameTree) {
+    std::string body = randomText(3000, "acgt", 6);
+    std::string path = testing::TempDir() + "suffix_tree_text_test.txt";
+    std::ofstream(path, std::ios::binary) << body;
+
+    SuffixTree mapped(Text::map(path, '$'));
+    SuffixTree copied(body + "$");
+    EXPECT_EQ(printed(mapped), printed(copied));
+    EXPECT_EQ(mapped.searchPattern("gattaca"), copied.searchPattern("gattaca"));
+    std::remove(path.c_str());
+}
+
+TEST(TextTest, MissingFileThrows) {
+    EXPECT_THROW(Text::map(testing::TempDir() + "no_such_suffix_tree_text"), std::system_error);
+}
+
+#endif
+
+#ifndef TEST_COUNT_PATTERN
+#define TEST_COUNT_PATTERN
+
+template <class Index>
+class CountPatternTest : public ::testing::Test {};
+TYPED_TEST_SUITE(CountPatternTest, QueryEngines);
+
+// Test that counting agrees with the size of the occurrence set
+TYPED_TEST(CountPatternTest, MatchesSearchPattern) {
+    std::string text = randomText(3000, "abc", 11) + "$";
+    TypeParam index(text);
+    std::mt19937_64 rng(12);
+    for (int i = 0; i < 500; ++i) {
+        std::string pattern = randomText(1 + rng() % 10, "abcd", rng());
+        EXPECT_EQ(index.countPattern(pattern), index.searchPattern(pattern).size()) << pattern;
+    }
+}
+
+// Test that the lazy occurrence view holds exactly the searchPattern hits
+TYPED_TEST(CountPatternTest, OccurrencesMatchSearchPattern) {
+    std::string text = randomText(3000, "abc", 13) + "$";
+    TypeParam index(text);
+    std::mt19937_64 rng(14);
+    for (int i = 0; i < 500; ++i) {
+        std::string pattern = randomText(1 + rng() % 10, "abcd", rng());
+        auto occurrences = index.findOccurrences(pattern);
+        EXPECT_EQ(occurrences.size(), index.countPattern(pattern));
+        EXPECT_EQ(std::set<u64>(occurrences.begin(), occurrences.end()), index.searchPattern(pattern)) << pattern;
+    }
+    EXPECT_TRUE(index.findOccurrences("").empty());
+}
+
+// Test that tree leaves are laid out in suffix order, so paging through a range is stable
+TEST(OccurrencesTest, TreeLeafOrderIsSuffixOrder) {
+    std::string text = randomText(3000, "abc", 15) + "$";
+    SuffixTree tree(text);
+    SuffixArray array(text);
+    for (std::string pattern : {"a", "ab", "cab", "bbb", "$"}) {
+        auto fromTree = tree.findOccurrences(pattern);
+        auto fromArray = array.findOccurrences(pattern);
+        EXPECT_TRUE(std::equal(fromTree.begin(), fromTree.end(), fromArray.begin(), fromArray.end())) << pattern;
+    }
+}
+
+TYPED_TEST(CountPatternTest, EdgeCases) {
+    TypeParam index(std::string("abcabxabcd$"));
+    EXPECT_EQ(index.countPattern(""), 0u);
+    EXPECT_EQ(index.countPattern("abc"), 2u);
+    EXPECT_EQ(index.countPattern("ab"), 3u);
+    EXPECT_EQ(index.countPattern("abcd$"), 1u);
+    EXPECT_EQ(index.countPattern("abcabxabcd$"), 1u);
+    EXPECT_EQ(index.countPattern("abcabxabcd$!"), 0u);
+    EXPECT_EQ(index.countPattern("z"), 0u);
+}
+
+// Test a hot pattern with one occurrence per position
+TYPED_TEST(CountPatternTest, RepetitiveText) {
+    TypeParam index(std::string(100000, 'a') + "$");
+    EXPECT_EQ(index.countPattern("a"), 100000u);
+    EXPECT_EQ(index.countPattern(std::string(1000, 'a')), 99001u);
+}
+
+#endif
+
+#ifndef TEST_FLAT_SUFFIX_TREE
+#define TEST_FLAT_SUFFIX_TREE
+
+// Test that a saved tree answers every query like the tree it came from
+TEST(FlatSuffixTreeTest, SaveLoadRoundTrip) {
+    std::string text = randomText(5000, "acgt", 21) + "$";
+    std::string path = testing::TempDir() + "flat_suffix_tree_roundtrip.idx";
+    SuffixTree tree(text);
+    tree.save(path);
+
+    FlatSuffixTree loaded = FlatSuffixTree::load(path);
+    EXPECT_EQ(loaded.getText(), text);
+    EXPECT_EQ(loaded.memoryUsage(), 0u);
+    std::mt19937_64 rng(22);
+    for (int i = 0; i < 500; ++i) {
+        std::string pattern = randomText(1 + rng() % 12, "acgt", rng());
+        auto expected = tree.findOccurrences(pattern);
+        auto actual = loaded.findOccurrences(pattern);
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(), actual.begin(), actual.end())) << pattern;
+    }
+    std::remove(path.c_str());
+}
+
+// Test that files which are not a valid index are rejected
+TEST(FlatSuffixTreeTest, RejectsCorruptFiles) {
+    std::string path = testing::TempDir() + "flat_suffix_tree_corrupt.idx";
+    FlatSuffixTree(std::string("banana$")).save(path);
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), {});
+    }
+    auto write = [&](const std::string& contents) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << contents;
+    };
+
+    write(bytes.substr(0, bytes.size() - 1));
+    EXPECT_THROW(FlatSuffixTree::load(path), std::runtime_error);
+    write("not an index" + bytes);
+    EXPECT_THROW(FlatSuffixTree::load(path), std::runtime_error);
+    write(bytes);
+    EXPECT_EQ(FlatSuffixTree::load(path).countPattern("ana"), 2u);
+    std::remove(path.c_str());
+}
+
+// Test that headers and node records pointing outside the file are rejected
+TEST(FlatSuffixTreeTest, RejectsOutOfRangeRecords) {
+    std::string path = testing::TempDir() + "flat_suffix_tree_records.idx";
+    FlatSuffixTree(std::string("banana$")).save(path);
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), {});
+    }
+    // Header: magic, version, byte order, text size, node count, leaf count,
+    // then the section offsets
+    constexpr u64 NodeCountAt = 24;
+    constexpr u64 LeafCountAt = 32;
+    constexpr u64 NodesOffsetAt = 48;
+    auto field = [&](u64 at) {
+        u64 value;
+        std::memcpy(&value, bytes.data() + at, sizeof(value));
+        return value;
+    };
+    auto loadPatched = [&](u64 at, const void* value, u64 size) {
+        std::string patched = bytes;
+        std::memcpy(patched.data() + at, value, size);
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << patched;
+        return FlatSuffixTree::load(path);
+    };
+
+    // Counts whose section size overflows 64 bits
+    u64 huge = (u64(1) << 62) + 1;
+    EXPECT_THROW(loadPatched(NodeCountAt, &huge, sizeof(huge)), std::runtime_error);
+    EXPECT_THROW(loadPatched(LeafCountAt, &huge, sizeof(huge)), std::runtime_error);
+
+    u64 rootAt = field(NodesOffsetAt);
+    u64 childAt = rootAt + 2 * sizeof(FlatSuffixTree::Node);  // "a", an internal node
+    u64 leafAt = rootAt + sizeof(FlatSuffixTree::Node);  // "$", a leaf
+    u32 outside = 1000;
+    u32 root = 0;
+    EXPECT_THROW(loadPatched(rootAt + offsetof(FlatSuffixTree::Node, childCount), &outside, 4), std::runtime_error);
+    EXPECT_THROW(loadPatched(childAt + offsetof(FlatSuffixTree::Node, firstChild), &root, 4), std::runtime_error);
+    EXPECT_THROW(loadPatched(childAt + offsetof(FlatSuffixTree::Node, length), &outside, 4), std::runtime_error);
+    EXPECT_THROW(loadPatched(childAt + offsetof(FlatSuffixTree::Node, leafCount), &outside, 4), std::runtime_error);
+    EXPECT_THROW(loadPatched(leafAt + offsetof(FlatSuffixTree::Node, firstChild), &outside, 4), std::runtime_error);
+    EXPECT_EQ(loadPatched(0, bytes.data(), 1).countPattern("ana"), 2u);
+    std::remove(path.c_str());
+}
+
+#endif
+
+#ifndef TEST_GENERALIZED_SUFFIX_TREE
+#define TEST_GENERALIZED_SUFFIX_TREE
+
+std::vector<u32> sortedDocuments(const GeneralizedSuffixTree& tree, const std::string& pattern) {
+    std::vector<u32> documents = tree.findDocuments(pattern);
+    std::sort(documents.begin(), documents.end());
+    return documents;
+}
+
+// Test document listing against a scan of every document
+TEST(GeneralizedSuffixTreeTest, MatchesNaiveListing) {
+    std::mt19937_64 rng(31);
+    std::vector<std::string> documents;
+    for (int i = 0; i < 200; ++i) {
+        documents.push_back(randomText(rng() % 60, "abc", rng()));
+    }
+    GeneralizedSuffixTree tree(documents);
+    for (int i = 0; i < 500; ++i) {
+        std::string pattern = randomText(1 + rng() % 6, "abc", rng());
+        std::vector<u32> expected;
+        for (u32 d = 0; d < documents.size(); ++d) {
+            if (documents[d].find(pattern) != std::string::npos) {
+                expected.push_back(d);
+            }
+        }
+        EXPECT_EQ(sortedDocuments(tree, pattern), expected) << pattern;
+    }
+}
+
+// Test that matches never span two documents and every document is reported once
+TEST(GeneralizedSuffixTreeTest, DocumentBoundaries) {
+    GeneralizedSuffixTree tree({"abab", "", "ba", "abab"});
+    EXPECT_EQ(sortedDocuments(tree, "ab"), (std::vector<u32>{0, 3}));
+    EXPECT_EQ(sortedDocuments(tree, "b"), (std::vector<u32>{0, 2, 3}));
+    EXPECT_EQ(sortedDocuments(tree, "bb"), std::vector<u32>{});
+    EXPECT_EQ(sortedDocuments(tree, "bab"), (std::vector<u32>{0, 3}));
+    EXPECT_EQ(sortedDocuments(tree, std::string("b") + GeneralizedSuffixTree::Separator), std::vector<u32>{});
+    EXPECT_EQ(sortedDocuments(tree, ""), std::vector<u32>{});
+    EXPECT_EQ(tree.documentOf(tree.getDocumentStart(2)), 2u);
+    EXPECT_THROW(GeneralizedSuffixTree({"a", std::string("b") + GeneralizedSuffixTree::Separator}), std::invalid_argument);
+}
+
+// Test the k-of-N common substrings against a brute-force search
+TEST(GeneralizedSuffixTreeTest, CommonSubstringOfKDocuments) {
+    std::mt19937_64 rng(32);
+    for (int round = 0; round < 20; ++round) {
+        std::vector<std::string> documents;
+        for (int i = 0; i < 6; ++i) {
+            documents.push_back(randomText(rng() % 40, "ab", rng()));
+        }
+        GeneralizedSuffixTree tree(documents);
+        for (u64 k = 1; k <= documents.size(); ++k) {
+            u64 expectedLength = 0;
+            std::set<std::string> expected;
+            for (const std::string& document : documents) {
+                for (u64 i = 0; i < document.size(); ++i) {
+                    for (u64 length = std::max<u64>(expectedLength, 1); i + length <= document.size(); ++length) {
+                        std::string candidate = document.substr(i, length);
+                        u64 holders = static_cast<u64>(std::count_if(documents.begin(), documents.end(), [&](const std::string& d) {
+                            return d.find(candidate) != std::string::npos;
+                        }));
+                        if (holders < k) {
+                            break;
+                        }
+                        if (length > expectedLength) {
+                            expectedLength = length;
+                            expected.clear();
+                        }
+                        expected.insert(candidate);
+                    }
+                }
+            }
+            auto [length, strings] = tree.findLCSString(k);
+            EXPECT_EQ(length, expectedLength) << "k = " << k;
+            EXPECT_EQ(strings, expected) << "k = " << k;
+        }
+    }
+    EXPECT_THROW(GeneralizedSuffixTree({"a"}).findLCSString(0), std::invalid_argument);
+}
+
+#endif
+
+#ifndef TEST_APPEND
+#define TEST_APPEND
+
+std::set<u64> naiveSearch(const std::string& text, const std::string& pattern) {
+    std::set<u64> positions;
+    for (u64 i = text.find(pattern); i != std::string::npos; i = text.find(pattern, i + 1)) {
+        positions.insert(i);
+    }
+    return positions;
+}
+
+// Test that queries between appends see every suffix of the text so far
+TEST(AppendTest, QueriesBetweenAppends) {
+    std::string text = randomText(2000, "ab", 41);
+    SuffixTree tree(std::string(""));
+    std::mt19937_64 rng(42);
+    for (u64 end = 0; end < text.size();) {
+        u64 next = std::min<u64>(text.size(), end + 1 + rng() % 50);
+        tree.append(std::string_view(text).substr(end, next - end));
+        end = next;
+
+        std::string prefix = text.substr(0, end);
+        for (int i = 0; i < 10; ++i) {
+            std::string pattern = randomText(1 + rng() % 8, "ab", rng());
+            auto occurrences = tree.findOccurrences(pattern);
+            EXPECT_EQ(std::set<u64>(occurrences.begin(), occurrences.end()), naiveSearch(prefix, pattern)) << pattern;
+            EXPECT_EQ(tree.countPattern(pattern), naiveSearch(prefix, pattern).size()) << pattern;
+        }
+    }
+}
+
+// Test that appending a text char by char builds the same tree as building it at once
+TEST(AppendTest, SameTreeAsBuild) {
+    std::string text = randomText(3000, "acgt", 43) + "$";
+    SuffixTree grown(std::string(""));
+    for (char c : text) {
+        grown.append(c);
+    }
+    grown.reindex();
+    SuffixTree built(text);
+    EXPECT_EQ(printed(grown), printed(built));
+    EXPECT_EQ(grown.countPattern("acg"), built.countPattern("acg"));
+}
+
+// Test that only copied texts without a terminator can grow
+TEST(AppendTest, RejectsFixedTexts) {
+    std::string body = "banana";
+    SuffixTree borrowed(Text::borrow(body));
+    EXPECT_THROW(borrowed.append('s'), std::logic_error);
+    SuffixTree terminated(Text::copy(body, '$'));
+    EXPECT_THROW(terminated.append('s'), std::logic_error);
+    SuffixTree copied(body);
+    copied.append("s");
+    EXPECT_EQ(copied.searchPattern("nas"), (std::set<u64>{4}));
+}
+
+#endif
+
+#ifndef TEST_MATCHING_STATISTICS
+#define TEST_MATCHING_STATISTICS
+
+// Test matching statistics against the longest prefix found by brute force
+TEST(MatchingStatisticsTest, MatchesNaive) {
+    std::string reference = randomText(2000, "abc", 51);
+    SuffixTree tree(reference + "$");
+    std::mt19937_64 rng(52);
+    for (int round = 0; round < 50; ++round) {
+        std::string query = randomText(rng() % 200, "abcd", rng());
+        std::vector<u64> statistics = tree.matchingStatistics(query);
+        ASSERT_EQ(statistics.size(), query.size());
+        for (u64 i = 0; i < query.size(); ++i) {
+            u64 expected = 0;
+            while (i + expected < query.size() && reference.find(query.substr(i, expected + 1)) != std::string::npos) {
+                ++expected;
+            }
+            EXPECT_EQ(statistics[i], expected) << query << " at " << i;
+        }
+    }
+}
+
+// Test that one tree answers the LCS of many queries like the pairwise version
+TEST(MatchingStatisticsTest, LCSAgainstManyQueries) {
+    std::string reference = randomText(500, "ab", 53);
+    SuffixTree tree(reference + "$");
+    std::mt19937_64 rng(54);
+    for (int round = 0; round < 100; ++round) {
+        std::string query = randomText(rng() % 100, "ab", rng());
+        auto expected = SuffixArray::findLCSString(reference, query);
+        if (expected.first == 0) {
+            expected.second.clear();
+        }
+        EXPECT_EQ(tree.findLCSString(query), expected) << query;
+    }
+    EXPECT_EQ(tree.findLCS(std::string_view("zz")).first, 0u);
+}
+
+#endif
+
+#ifndef TEST_PARALLEL_BUILD
+#define TEST_PARALLEL_BUILD
+
+std::string savedBytes(const SuffixTree& tree) {
+    std::string path = testing::TempDir() + "parallel_build.idx";
+    tree.save(path);
+    std::ifstream in(path, std::ios::binary);
+    std::string bytes(std::istreambuf_iterator<char>(in), {});
+    std::remove(path.c_str());
+    return bytes;
+}
+
+// Test that the suffix array builder reproduces the Ukkonen tree, edge starts included
+TEST(ParallelBuildTest, SameTreeAsUkkonen) {
+    std::vector<std::string> texts = {
+        randomText(5000, "ab", 61),
+        randomText(5000, "acgt", 62),
+        randomText(5000, "abcdefghijklmnopqrstuvwxyz ", 63),
+        std::string(3000, 'a'),
+        "abcabxabcd",
+    };
+    for (const std::string& body : texts) {
+        SuffixTree sequential(Text::copy(body, '$'));
+        SuffixTree parallel(Text::copy(body, '$'), 4);
+        EXPECT_EQ(printed(parallel), printed(sequential));
+        EXPECT_EQ(savedBytes(parallel), savedBytes(sequential));
+    }
+}
+
+// Test that suffix links and the active point support queries and appends afterwards
+TEST(ParallelBuildTest, SuffixLinksAndAppend) {
+    std::string body = randomText(4000, "acgt", 64) + "$";
+    SuffixTree sequential(body);
+    SuffixTree parallel(Text::copy(body), 3);
+    std::string query = randomText(500, "acgt", 65);
+    EXPECT_EQ(parallel.matchingStatistics(query), sequential.matchingStatistics(query));
+
+    sequential.append("acgtacgt#");
+    parallel.append("acgtacgt#");
+    sequential.reindex();
+    parallel.reindex();
+    EXPECT_EQ(printed(parallel), printed(sequential));
+}
+
+// Test that an exception in any worker reaches the caller once all are joined
+TEST(ParallelBuildTest, WorkerExceptionsReachTheCaller) {
+    for (u32 threads : {1u, 4u}) {
+        std::atomic<u64> done = 0;
+        auto body = [&](u64 i) {
+            if (i == 10) {
+                throw std::length_error("body " + std::to_string(i));
+            }
+            ++done;
+        };
+        EXPECT_THROW(parallelFor(1000, threads, body), std::length_error);
+        EXPECT_LT(done.load(), 1000u);
+    }
+}
+
+#endif
+
+#ifndef TEST_STATS
+#define TEST_STATS
+
+// Test the shape statistics, and the construction counters when they are compiled in
+TEST(StatsTest, ShapeAndCounters) {
+    SuffixTree tree(std::string("abcabxabcd$"));
+    TreeStats stats = tree.stats();
+    EXPECT_EQ(stats.leaves, 11u);
+    EXPECT_EQ(stats.nodes, 17u);
+    EXPECT_EQ(stats.maxDepth, 3u);
+    EXPECT_EQ(stats.bytes, tree.memoryUsage());
+    if constexpr (StatsEnabled) {
+        EXPECT_EQ(stats.extensions, stats.leaves);
+        EXPECT_EQ(stats.splits, stats.nodes - stats.leaves - 1);
+        EXPECT_FALSE(stats.phases.empty());
+    } else {
+        EXPECT_EQ(stats.splits, 0u);
+        EXPECT_TRUE(stats.phases.empty());
+    }
+}
+
+// Test that repeated appends and reindexes keep one entry per phase
+TEST(StatsTest, RepeatedPhasesAccumulate) {
+    SuffixTree tree(std::string(""));
+    for (char c : randomText(500, "ab", 81)) {
+        tree.append(c);
+        tree.reindex();
+    }
+    std::vector<std::pair<std::string_view, double>> phases = tree.stats().phases;
+    for (u64 i = 0; i < phases.size(); ++i) {
+        for (u64 j = i + 1; j < phases.size(); ++j) {
+            EXPECT_NE(phases[i].first, phases[j].first);
+        }
+    }
+    EXPECT_LE(phases.size(), 3u);
+}
+
+#endif
+
+#ifndef TEST_BATCH_SEARCH
+#define TEST_BATCH_SEARCH
+
+// Patterns built from a few shared prefixes, with duplicates, misses and an empty one
+std::vector<std::string> prefixHeavyPatterns(const std::string& text, std::mt19937& rng) {
+    std::vector<std::string> patterns = {"", "#", text.substr(0, 3) + "#"};
+    for (int i = 0; i < 20; ++i) {
+        std::string prefix = text.substr(rng() % (text.size() - 8), 1 + rng() % 6);
+        for (int j = 0; j < 10; ++j) {
+            std::string pattern = prefix;
+            for (u64 k = rng() % 4; k > 0; --k) {
+                pattern += "abc#"[rng() % 4];
+            }
+            patterns.push_back(pattern);
+        }
+    }
+    std::shuffle(patterns.begin(), patterns.end(), rng);
+    return patterns;
+}
+
+// Test that batch answers match the single queries, in input order
+TEST(BatchSearchTest, MatchesSingleQueries) {
+    std::mt19937 rng(18);
+    std::string text = randomText(3000, "abc", 18);
+    SuffixTree tree(text + "$");
+    std::vector<std::string> patterns = prefixHeavyPatterns(text, rng);
+
+    auto found = tree.searchPatterns(patterns);
+    auto counts = tree.countPatterns(patterns);
+    ASSERT_EQ(found.size(), patterns.size());
+    ASSERT_EQ(counts.size(), patterns.size());
+    for (u64 i = 0; i < patterns.size(); ++i) {
+        EXPECT_EQ(found[i], tree.searchPattern(patterns[i])) << patterns[i];
+        EXPECT_EQ(counts[i], tree.countPattern(patterns[i])) << patterns[i];
+    }
+}
+
+// Test the batch queries while some suffixes are still implicit after appends
+TEST(BatchSearchTest, AfterAppend) {
+    std::mt19937 rng(19);
+    std::string text = randomText(500, "ab", 19);
+    SuffixTree tree(std::string(""));
+    tree.append(text);
+    std::vector<std::string> patterns = prefixHeavyPatterns(text, rng);
+
+    auto found = tree.searchPatterns(patterns);
+    auto counts = tree.countPatterns(patterns);
+    for (u64 i = 0; i < patterns.size(); ++i) {
+        if (patterns[i].empty()) {
+            EXPECT_TRUE(found[i].empty());
+            continue;
+        }
+        EXPECT_EQ(found[i], naiveSearch(text, patterns[i])) << patterns[i];
+        EXPECT_EQ(counts[i], found[i].size()) << patterns[i];
+    }
+}
+
+#endif
+
+#ifndef TEST_ALPHABET_SUFFIX_TREE
+#define TEST_ALPHABET_SUFFIX_TREE
+
+// '$' sorts before the bases in char order too, so both trees print the same
+TEST(AlphabetSuffixTreeTest, SameShapeAsSuffixTree) {
+    for (std::string text : {"A", "ACGT", "GATTACA", "AAAAAAAA", "ACGACGTACGACGA"}) {
+        std::ostringstream dna, generic;
+        dna << DnaSuffixTree(text);
+        generic << SuffixTree(text + "$");
+        EXPECT_EQ(dna.str(), generic.str()) << text;
+    }
+}
+
+// Test the pattern queries against SuffixTree on random DNA
+TEST(AlphabetSuffixTreeTest, QueriesMatchSuffixTree) {
+    std::mt19937 rng(17);
+    std::string text(2000, 'A');
+    for (auto& c : text) {
+        c = "ACGT"[rng() % 4];
+    }
+    DnaSuffixTree dna(text);
+    SuffixTree generic(text + "$");
+    for (int i = 0; i < 200; ++i) {
+        std::string pattern = text.substr(rng() % text.size(), 1 + rng() % 12);
+        if (i % 4 == 0) {
+            pattern.back() = "ACGT"[rng() % 4];
+        }
+        EXPECT_EQ(dna.searchPattern(pattern), generic.searchPattern(pattern)) << pattern;
+        EXPECT_EQ(dna.countPattern(pattern), generic.countPattern(pattern)) << pattern;
+    }
+    EXPECT_EQ(dna.countPattern("ACGN"), 0u);
+    EXPECT_EQ(dna.countPattern("$"), 0u);
+    EXPECT_EQ(dna.countPattern(""), 0u);
+}
+
+// Test that the text takes 2 bits per base
+TEST(AlphabetSuffixTreeTest, PackedText) {
+    DnaSuffixTree tree(std::string(1000, 'G'));
+    EXPECT_EQ(tree.textBytes(), 256u);
+    EXPECT_EQ(tree.countPattern("GGG"), 998u);
+}
+
+// Test that symbols outside the alphabet are rejected
+TEST(AlphabetSuffixTreeTest, RejectsInvalidSymbols) {
+    EXPECT_THROW(DnaSuffixTree("ACGN"), std::invalid_argument);
+    EXPECT_THROW(DnaSuffixTree("acgt"), std::invalid_argument);
+}
+
+// Test that the virtual terminator never matches, inside an edge or where it
+// would branch off, and neither does any other symbol outside the alphabet
+TEST(AlphabetSuffixTreeTest, PatternsOutsideTheAlphabet) {
+    DnaSuffixTree edge("TAGTT");     // "TT$" would end inside a leaf edge
+    EXPECT_EQ(edge.countPattern("TT"), 1u);
+    EXPECT_EQ(edge.countPattern("TT$"), 0u);
+    EXPECT_TRUE(edge.findOccurrences("T$").empty());
+
+    DnaSuffixTree branch("CAGG");    // "G$" would branch off the "G" node
+    EXPECT_EQ(branch.countPattern("G"), 2u);
+    EXPECT_EQ(branch.countPattern("G$"), 0u);
+    EXPECT_EQ(branch.countPattern("$"), 0u);
+    EXPECT_TRUE(branch.searchPattern("GN").empty());
+}
+
+#endif
+
+#ifndef TEST_FM_INDEX
+#define TEST_FM_INDEX
+
+// Test rank and access against a plain scan, for every symbol width
+TEST(WaveletMatrixTest, RankAndAccess) {
+    std::mt19937 rng(21);
+    for (u32 bits = 1; bits <= 8; ++bits) {
+        std::vector<u8> symbols(700);
+        for (auto& symbol : symbols) {
+            symbol = static_cast<u8>(rng() % (1u << bits));
+        }
+        WaveletMatrix matrix(symbols, bits);
+        for (u64 pos = 0; pos <= symbols.size(); pos += 13) {
+            u8 symbol = symbols[pos % symbols.size()];
+            auto expected = std::count(symbols.begin(), symbols.begin() + static_cast<i64>(pos), symbol);
+            EXPECT_EQ(matrix.rank(symbol, pos), static_cast<u64>(expected));
+        }
+        for (u64 pos = 0; pos < symbols.size(); ++pos) {
+            EXPECT_EQ(matrix.access(pos), symbols[pos]);
+        }
+    }
+}
+
+// Test that every sample rate locates the same positions as the suffix array
+TEST(FMIndexTest, SampleRatesAgree) {
+    std::string text = randomText(5000, "acgt", 22) + "$";
+    SuffixArray array(text);
+    std::mt19937_64 rng(23);
+    for (u32 rate : {1u, 3u, 32u, 1000u}) {
+        FMIndex index(text, rate);
+        EXPECT_EQ(index.getSampleRate(), rate);
+        for (int i = 0; i < 100; ++i) {
+            std::string pattern = text.substr(rng() % text.size(), 1 + rng() % 8);
+            auto expected = array.findOccurrences(pattern);
+            auto located = index.findOccurrences(pattern);
+            EXPECT_TRUE(std::equal(located.begin(), located.end(), expected.begin(), expected.end())) << pattern;
+        }
+    }
+}
+
+// Test texts without a terminator and with bytes above 127
+TEST(FMIndexTest, AnyText) {
+    std::string text = "\xff\x80" "ab" "\xff" "ab" "\x80";
+    FMIndex index(text, 2);
+    EXPECT_EQ(index.searchPattern("ab"), (std::set<u64>{2, 5}));
+    EXPECT_EQ(index.searchPattern("\xff"), (std::set<u64>{0, 4}));
+    EXPECT_EQ(index.searchPattern("b\x80"), (std::set<u64>{6}));
+    EXPECT_EQ(index.countPattern("ba"), 0u);
+
+    FMIndex empty("");
+    EXPECT_EQ(empty.countPattern("a"), 0u);
+    EXPECT_THROW(FMIndex("abc", 0), std::invalid_argument);
+}
+
+// Test that sparser sampling takes less memory, and that it stays far below the array
+TEST(FMIndexTest, MemoryFollowsSampleRate) {
+    std::string text = randomText(100000, "acgt", 24) + "$";
+    u64 dense = FMIndex(text, 4).memoryUsage();
+    u64 sparse = FMIndex(text, 64).memoryUsage();
+    EXPECT_LT(sparse, dense);
+    EXPECT_LT(sparse, text.size());
+    EXPECT_LT(dense, SuffixArray(text).memoryUsage() / 4);
+}
+
+#endif
+
+#ifndef TEST_DISK_SUFFIX_ARRAY
+#define TEST_DISK_SUFFIX_ARRAY
+
+// Builds the on-disk array of text with the given budget and checks it against
+// the in-memory one
+void checkDiskSuffixArray(const std::string& text, u64 memoryBudget) {
+    std::string textPath = testing::TempDir() + "disk_suffix_array_test.txt";
+    std::string indexPath = testing::TempDir() + "disk_suffix_array_test.idx";
+    std::ofstream(textPath, std::ios::binary) << text;
+
+    DiskSuffixArray::build(textPath, indexPath, memoryBudget, '$');
+    DiskSuffixArray disk = DiskSuffixArray::load(indexPath);
+    SuffixArray memory(text + "$");
+    ASSERT_EQ(disk.getText(), text + "$");
+    ASSERT_EQ(disk.getSize(), memory.getSize());
+    for (u64 rank = 0; rank < disk.getSize(); ++rank) {
+        ASSERT_EQ(disk.getSuffix(rank), memory.getSuffix(rank)) << rank;
+    }
+    for (std::string pattern : {"a", "ab", "ba$", "bbb", "c", ""}) {
+        EXPECT_EQ(disk.searchPattern(pattern), memory.searchPattern(pattern)) << pattern;
+    }
+    EXPECT_EQ(disk.memoryUsage(), 0u);
+    std::remove(textPath.c_str());
+    std::remove(indexPath.c_str());
+}
+
+// Test a text whose records take several sorted runs
+TEST(DiskSuffixArrayTest, ManyRuns) {
+    checkDiskSuffixArray(randomText(200000, "acgt", 25), DiskSuffixArray::MinMemoryBudget);
+}
+
+// Test long repeats, which take many doubling rounds, and tiny texts
+TEST(DiskSuffixArrayTest, DeepRepeatsAndTinyTexts) {
+    std::string periodic;
+    for (int i = 0; i < 3000; ++i) {
+        periodic += "ab";
+    }
+    checkDiskSuffixArray(periodic, DiskSuffixArray::MinMemoryBudget);
+    checkDiskSuffixArray("", DiskSuffixArray::MinMemoryBudget);
+    checkDiskSuffixArray("a", DiskSuffixArray::MinMemoryBudget);
+    checkDiskSuffixArray("\xff\x01\xff", DiskSuffixArray::MinMemoryBudget);
+}
+
+// Test that bad budgets and bad files are rejected
+TEST(DiskSuffixArrayTest, Errors) {
+    std::string path = testing::TempDir() + "disk_suffix_array_bad.idx";
+    EXPECT_THROW(DiskSuffixArray::build(path, path, 1024), std::invalid_argument);
+    std::ofstream(path, std::ios::binary) << std::string(100, 'x');
+    EXPECT_THROW(DiskSuffixArray::load(path), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+// Test that suffix positions pointing outside the text are rejected
+TEST(DiskSuffixArrayTest, RejectsOutOfRangeSuffixes) {
+    std::string textPath = testing::TempDir() + "disk_suffix_array_records.txt";
+    std::string path = testing::TempDir() + "disk_suffix_array_records.idx";
+    std::ofstream(textPath, std::ios::binary) << "banana";
+    DiskSuffixArray::build(textPath, path, DiskSuffixArray::MinMemoryBudget, '$');
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), {});
+    }
+    // Header: magic, version, byte order, text size, text offset, suffixes offset
+    constexpr u64 SuffixesOffsetAt = 32;
+    u64 suffixesAt;
+    std::memcpy(&suffixesAt, bytes.data() + SuffixesOffsetAt, sizeof(suffixesAt));
+    auto loadPatched = [&](u64 rank, u64 suffix) {
+        std::string patched = bytes;
+        std::memcpy(patched.data() + suffixesAt + rank * sizeof(u64), &suffix, sizeof(suffix));
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << patched;
+        return DiskSuffixArray::load(path);
+    };
+
+    EXPECT_THROW(loadPatched(0, 7), std::runtime_error);  // "banana$" has 7 positions
+    EXPECT_THROW(loadPatched(6, limit<u64>::max()), std::runtime_error);
+    EXPECT_EQ(loadPatched(0, 6).countPattern("ana"), 2u);  // The original entry
+    std::remove(textPath.c_str());
+    std::remove(path.c_str());
+}
+
+#endif
+
+#ifndef TEST_REPEATS
+#define TEST_REPEATS
+
+// Every distinct substring of the text with its occurrences
+std::map<std::string, std::vector<u64>> allSubstrings(const std::string& text) {
+    std::map<std::string, std::vector<u64>> substrings;
+    for (u64 i = 0; i < text.size(); ++i) {
+        for (u64 length = 1; i + length <= text.size(); ++length) {
+            substrings[text.substr(i, length)].push_back(i);
+        }
+    }
+    return substrings;
+}
+
+// Test the repeat queries against brute force on small random texts
+TEST(RepeatsTest, MatchBruteForce) {
+    for (u64 seed = 0; seed < 20; ++seed) {
+        std::string text = randomText(60 + seed * 5, seed % 2 ? "ab" : "abcd", seed);
+        SuffixTree tree(text + "$");
+        auto substrings = allSubstrings(text);
+
+        SuffixTree::Repeat longest = {0, 0, 0};
+        std::vector<SuffixTree::Repeat> maximal;
+        std::vector<SuffixTree::Repeat> frequent;
+        const u64 minLength = 3;
+        for (const auto& [substring, positions] : substrings) {
+            if (positions.size() < 2) {
+                continue;
+            }
+            SuffixTree::Repeat repeat = {positions.front(), substring.size(), positions.size()};
+            if (repeat.length > longest.length || (repeat.length == longest.length && repeat.start < longest.start)) {
+                longest = repeat;
+            }
+
+            // The ends of the text count as characters of their own
+            std::set<char> left, right;
+            for (u64 position : positions) {
+                left.insert(position == 0 ? '^' : text[position - 1]);
+                right.insert(position + substring.size() == text.size() ? '$' : text[position + substring.size()]);
+            }
+            if (left.size() > 1 && right.size() > 1) {
+                maximal.push_back(repeat);
+            }
+
+            // Only the shortest substring of at least minLength on each edge
+            std::string shorter = substring.substr(0, substring.size() - 1);
+            if (substring.size() == minLength ||
+                (substring.size() > minLength && substrings[shorter].size() != positions.size())) {
+                frequent.push_back(repeat);
+            }
+        }
+        std::sort(maximal.begin(), maximal.end(), [](const auto& a, const auto& b) {
+            return std::tie(a.start, a.length) < std::tie(b.start, b.length);
+        });
+        std::sort(frequent.begin(), frequent.end(), [](const auto& a, const auto& b) {
+            return std::tie(b.count, a.length, a.start) < std::tie(a.count, b.length, b.start);
+        });
+        frequent.resize(std::min<u64>(frequent.size(), 10));
+
+        EXPECT_EQ(tree.longestRepeat(), longest) << text;
+        EXPECT_EQ(tree.maximalRepeats(), maximal) << text;
+        EXPECT_EQ(tree.frequentSubstrings(10, minLength), frequent) << text;
+    }
+}
+
+// Test the degenerate inputs and the requirement of a unique terminator
+TEST(RepeatsTest, EdgeCases) {
+    SuffixTree distinct(std::string("abcd$"));
+    EXPECT_EQ(distinct.longestRepeat().length, 0u);
+    EXPECT_TRUE(distinct.maximalRepeats().empty());
+    EXPECT_TRUE(distinct.frequentSubstrings(5, 1).empty());
+
+    SuffixTree runs(std::string("aaaa$"));
+    EXPECT_EQ(runs.longestRepeat(), (SuffixTree::Repeat{0, 3, 2}));
+    EXPECT_EQ(runs.frequentSubstrings(1, 1), (std::vector<SuffixTree::Repeat>{{0, 1, 4}}));
+    EXPECT_TRUE(runs.frequentSubstrings(0, 1).empty());
+
+    SuffixTree open(std::string("abab"));
+    EXPECT_THROW(open.longestRepeat(), std::logic_error);
+}
+
+#endif
+
+#ifndef TEST_OUTPUT_WRITER
+#define TEST_OUTPUT_WRITER
+
+// Test the digit conversion on every length and on the limits
+TEST(OutputWriterTest, DecimalMatchesToString) {
+    std::vector<u64> values = {0, 9, 10, 99, 100, 12345, std::numeric_limits<u64>::max()};
+    for (u64 value = 1; value < std::numeric_limits<u64>::max() / 10; value *= 10) {
+        values.push_back(value - 1);
+        values.push_back(value);
+        values.push_back(value + 7);
+    }
+    for (u64 value : values) {
+        std::string out = "x";
+        appendDecimal(out, value);
+        EXPECT_EQ(out.substr(1), std::to_string(value));
+        EXPECT_EQ(out[0], 'x');
+    }
+}
+
+// Test that buffered, flushed and oversized writes reach the file in order
+TEST(OutputWriterTest, WritesInOrder) {
+    std::string path = testing::TempDir() + "output_writer_test.txt";
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    ASSERT_NE(file, nullptr);
+
+    std::string expected;
+    {
+        OutputWriter writer(fileno(file), 16);
+        for (u64 i = 0; i < 100; ++i) {
+            writer.writeDecimal(i * 997);
+            writer.write(", ");
+            expected += std::to_string(i * 997) + ", ";
+        }
+        std::string large(40, 'z');
+        writer.write(large);
+        expected += large;
+        EXPECT_LE(writer.pending(), 16u);
+        writer.flush();
+        EXPECT_EQ(writer.pending(), 0u);
+    }
+    std::fclose(file);
+
+    std::ifstream in(path);
+    std::string written((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(written, expected);
+    std::remove(path.c_str());
+}
+
+#endif
+
+#ifndef TEST_QUERY_CACHE
+#define TEST_QUERY_CACHE
+
+std::vector<u64> sortedOccurrences(SuffixTree const& tree, std::string const& pattern) {
+    auto occurrences = tree.findOccurrences(pattern);
+    std::vector<u64> sorted(occurrences.begin(), occurrences.end());
+    std::sort(sorted.begin(), sorted.end());
+    return sorted;
+}
+
+// Test that a repeated pattern is answered from the cache without searching
+TEST(QueryCacheTest, HitsAndMisses) {
+    SuffixTree tree(std::string("abracadabra"));
+    QueryCache cache(1 << 20);
+    u64 searches = 0;
+    auto search = [&]() {
+        ++searches;
+        return sortedOccurrences(tree, "abra");
+    };
+
+    auto first = cache.get("abra", tree.getVersion(), search);
+    auto second = cache.get("abra", tree.getVersion(), search);
+    EXPECT_EQ(*first, (std::vector<u64>{0, 7}));
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(searches, 1u);
+
+    QueryCache::Stats stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.entries, 1u);
+    EXPECT_EQ(stats.bytes, QueryCache::EntryOverhead + 4 + 2 * sizeof(u64));
+}
+
+// Test that the least recently used entries go first and the budget holds
+TEST(QueryCacheTest, EvictsLeastRecentlyUsed) {
+    u64 entryBytes = QueryCache::EntryOverhead + 1 + sizeof(u64);
+    QueryCache cache(3 * entryBytes);
+    auto one = []() { return std::vector<u64>{1}; };
+
+    cache.get("a", 0, one);
+    cache.get("b", 0, one);
+    cache.get("c", 0, one);
+    cache.get("a", 0, one);  // "b" is now the oldest
+    cache.get("d", 0, one);
+
+    QueryCache::Stats stats = cache.stats();
+    EXPECT_EQ(stats.evictions, 1u);
+    EXPECT_EQ(stats.entries, 3u);
+    EXPECT_LE(stats.bytes, cache.getByteBudget());
+
+    u64 searches = 0;
+    auto counted = [&]() { ++searches; return std::vector<u64>{1}; };
+    cache.get("a", 0, counted);
+    cache.get("c", 0, counted);
+    cache.get("d", 0, counted);
+    EXPECT_EQ(searches, 0u);
+    cache.get("b", 0, counted);
+    EXPECT_EQ(searches, 1u);
+
+    // Larger than the whole budget: answered, never stored
+    auto large = cache.get("e", 0, []() { return std::vector<u64>(1000, 7); });
+    EXPECT_EQ(large->size(), 1000u);
+    EXPECT_LE(cache.stats().bytes, cache.getByteBudget());
+}
+
+// Test that appending to the tree invalidates the cached answers
+TEST(QueryCacheTest, InvalidatedByAppend) {
+    SuffixTree tree(std::string("abab"));
+    QueryCache cache(1 << 20);
+    auto search = [&]() { return sortedOccurrences(tree, "ab"); };
+
+    EXPECT_EQ(*cache.get("ab", tree.getVersion(), search), (std::vector<u64>{0, 2}));
+    tree.append("ab");
+    EXPECT_EQ(*cache.get("ab", tree.getVersion(), search), (std::vector<u64>{0, 2, 4}));
+
+    QueryCache::Stats stats = cache.stats();
+    EXPECT_EQ(stats.hits, 0u);
+    EXPECT_EQ(stats.invalidations, 1u);
+    EXPECT_EQ(indexVersion(SuffixArray("abab$")), 0u);
+}
+
+// Test that threads sharing one cache all get the right answers
+TEST(QueryCacheTest, SharedAcrossThreads) {
+    std::string text = randomText(20000, "acgt", 51);
+    SuffixTree tree(text);
+    std::vector<std::string> patterns;
+    for (u64 i = 0; i < 64; ++i) {
+        patterns.push_back(text.substr(i * 97, 1 + i % 6));
+    }
+    QueryCache cache(16 * 1024);
+
+    std::vector<std::thread> threads;
+    std::atomic<u64> wrong = 0;
+    for (u64 t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t]() {
+            for (u64 i = 0; i < 2000; ++i) {
+                const std::string& pattern = patterns[(i * (t + 3)) % patterns.size()];
+                auto positions = cache.get(pattern, tree.getVersion(), [&]() {
+                    return sortedOccurrences(tree, pattern);
+                });
+                if (*positions != sortedOccurrences(tree, pattern)) {
+                    ++wrong;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(wrong, 0u);
+    QueryCache::Stats stats = cache.stats();
+    EXPECT_EQ(stats.hits + stats.misses, 8000u);
+    EXPECT_LE(stats.bytes, cache.getByteBudget());
+}
+
+#endif
+
+#ifndef TEST_CONST_QUERIES
+#define TEST_CONST_QUERIES
+
+// Patterns sampled from the text, with misses, to query a tree with
+std::vector<std::string> samplePatterns(const std::string& text, u64 count, u64 seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<std::string> patterns;
+    for (u64 i = 0; i < count; ++i) {
+        std::string pattern = text.substr(rng() % (text.size() - 40), 1 + rng() % 40);
+        if (i % 5 == 0) {
+            pattern.back() = '#';
+        }
+        patterns.push_back(pattern);
+    }
+    return patterns;
+}
+
+// Test that threads querying one shared tree without locks see the same
+// answers as a single thread does
+TEST(ConstQueryTest, SharedAcrossThreads) {
+    std::string text = randomText(100000, "acgt", 63);
+    const SuffixTree indexed(text + "$");
+    SuffixTree grown(text.substr(0, 60000));
+    grown.append(std::string_view(text).substr(60000));
+    std::vector<std::string> patterns = samplePatterns(text, 400, 64);
+
+    for (const SuffixTree* tree : {&indexed, static_cast<const SuffixTree*>(&grown)}) {
+        std::vector<std::vector<u32>> expected;
+        for (const std::string& pattern : patterns) {
+            auto occurrences = tree->findOccurrences(pattern);
+            expected.emplace_back(occurrences.begin(), occurrences.end());
+        }
+
+        std::atomic<u64> wrong = 0;
+        std::vector<std::thread> threads;
+        for (u64 t = 0; t < 8; ++t) {
+            threads.emplace_back([&, t]() {
+                for (u64 round = 0; round < 5; ++round) {
+                    for (u64 i = t; i < patterns.size(); i += 3) {
+                        auto occurrences = tree->findOccurrences(patterns[i]);
+                        if (!std::equal(occurrences.begin(), occurrences.end(), expected[i].begin(), expected[i].end())
+                            || tree->countPattern(patterns[i]) != expected[i].size()) {
+                            ++wrong;
+                        }
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        EXPECT_EQ(wrong, 0u);
+    }
+}
+
+#endif
+
+#ifndef TEST_FREEZE
+#define TEST_FREEZE
+
+// Test that a frozen tree answers like the tree it was built from
+TEST(FreezeTest, SameAnswers) {
+    std::string text = randomText(20000, "acgt", 71) + "$";
+    SuffixTree tree(text);
+    SuffixTree frozen(text);
+    u64 unfrozenBytes = frozen.memoryUsage();
+    frozen.freeze();
+    EXPECT_TRUE(frozen.isFrozen());
+    EXPECT_LT(frozen.memoryUsage(), unfrozenBytes);
+
+    std::vector<std::string> patterns = samplePatterns(text, 300, 72);
+    patterns.push_back("");
+    for (const std::string& pattern : patterns) {
+        EXPECT_EQ(frozen.searchPattern(pattern), tree.searchPattern(pattern)) << pattern;
+        EXPECT_EQ(frozen.countPattern(pattern), tree.countPattern(pattern)) << pattern;
+    }
+    EXPECT_EQ(frozen.countPatterns(patterns), tree.countPatterns(patterns));
+    EXPECT_EQ(frozen.searchPatterns(patterns), tree.searchPatterns(patterns));
+
+    std::string path = testing::TempDir() + "frozen_tree_test.idx";
+    frozen.save(path);
+    FlatSuffixTree loaded = FlatSuffixTree::load(path);
+    EXPECT_EQ(loaded.countPattern("acgt"), tree.countPattern("acgt"));
+    std::remove(path.c_str());
+}
+
+// Test that a frozen tree rejects mutation and the queries that need the arena
+TEST(FreezeTest, RejectsMutation) {
+    SuffixTree tree(std::string("banana"));
+    tree.append("$");
+    EXPECT_THROW(tree.freeze(), std::logic_error);  // Not reindexed
+    EXPECT_FALSE(tree.isFrozen());
+    tree.reindex();
+    TreeStats before = tree.stats();
+    tree.freeze();
+
+    // The shape and construction counters outlive the arena
+    TreeStats after = tree.stats();
+    EXPECT_EQ(after.nodes, before.nodes);
+    EXPECT_EQ(after.leaves, before.leaves);
+    EXPECT_EQ(after.maxDepth, before.maxDepth);
+    EXPECT_EQ(after.extensions, before.extensions);
+    EXPECT_EQ(after.bytes, tree.memoryUsage());
+
+    EXPECT_THROW(tree.append('s'), std::logic_error);
+    EXPECT_THROW(tree.buildTree("abc"), std::logic_error);
+    EXPECT_THROW(tree.reindex(), std::logic_error);
+    EXPECT_THROW(tree.freeze(), std::logic_error);
+    EXPECT_THROW(tree.matchingStatistics("ana"), std::logic_error);
+    EXPECT_THROW(tree.longestRepeat(), std::logic_error);
+    EXPECT_EQ(tree.searchPattern("ana"), (std::set<u64>{1, 3}));
 }
 
+#endif
+
+#ifndef TEST_CHILD_TABLE
+#define TEST_CHILD_TABLE
+
+std::vector<std::pair<char, u32>> childrenOf(ChildTable const& table) {
+    std::vector<std::pair<char, u32>> children;
+    table.forEach([&](char key, u32 node) {
+        children.emplace_back(key, node);
+    });
+    return children;
+}
 
+// Test that the layout grows with the fan-out and keeps every edge
+TEST(ChildTableTest, LayoutFollowsFanOut) {
+    ChildTable table;
+    std::string keys = "zyxwvutsrqponmlkjihgfedcba";
+    for (u32 i = 0; i < keys.size(); ++i) {
+        table.set(keys[i], i);
+        if (table.size() <= ChildTable::InlineCapacity) {
+            EXPECT_EQ(table.layout(), ChildTable::Layout::Inline);
+        } else if (table.size() <= ChildTable::SortedCapacity) {
+            EXPECT_EQ(table.layout(), ChildTable::Layout::Sorted);
+        } else {
+            EXPECT_EQ(table.layout(), ChildTable::Layout::Dense);
+        }
+        for (u32 j = 0; j <= i; ++j) {
+            EXPECT_EQ(table.find(keys[j]), j);
+        }
+        EXPECT_EQ(table.find('#'), ChildTable::NoNode);
+    }
+}
+
+// Test that replacing an edge does not add a child
+TEST(ChildTableTest, ReplaceKeepsSize) {
+    ChildTable table;
+    table.set('a', 1);
+    table.set('b', 2);
+    table.set('a', 3);
+    EXPECT_EQ(table.size(), 2);
+    EXPECT_EQ(table.find('a'), 3u);
+}
+
+// Test that every layout iterates in char order, as std::map<char, ...> did
+TEST(ChildTableTest, IterationInCharOrder) {
+    std::vector<char> keys = {'m', '\x90', 'a', '$', '\xff', 'Z', '0', '~',
+                              '\x01', 'q', 'b', ' ', '\x80', 'k', 'c', '9', 'x', '#'};
+    ChildTable table;
+    for (u32 i = 0; i < keys.size(); ++i) {
+        table.set(keys[i], i);
+
+        auto children = childrenOf(table);
+        ASSERT_EQ(children.size(), i + 1);
+        for (u64 j = 1; j < children.size(); ++j) {
+            EXPECT_LT(children[j - 1].first, children[j].first);
+        }
+    }
+    EXPECT_EQ(table.layout(), ChildTable::Layout::Dense);
+}
 
 #endif
 